@@ -0,0 +1,212 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Internal structure of arrays body store.
+
+    struct p2d_object is owned by the user and is mostly cold data (the shape union, out pointers,
+    user_data...), so during p2d_step() the simulation runs on packed per-field arrays instead.
+    Objects are copied in at the start of every step and written back (along with their out
+    pointers) once at the end of it.
+
+    Live bodies are kept dense at the front of every array, in the same order as p2d_objects.
+    Removal swaps the last body into the hole, so objects hold a stable handle instead, which
+    maps to the body's current dense index. Freed handles are reused.
+
+    The narrow phase and solver still speak struct p2d_object, so they are fed stack proxies
+    filled from the store (see p2d_body_proxy), and their results are stored back by index.
+*/
+
+#ifndef P2D_BODY_H
+#define P2D_BODY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+#include "p2d/types.h"
+
+enum p2d_body_flags {
+    P2D_BODY_ALIVE      = 1 << 0,
+    P2D_BODY_STATIC     = 1 << 1,
+    P2D_BODY_TRIGGER    = 1 << 2,
+    P2D_BODY_SLEEPING   = 1 << 3,
+    P2D_BODY_CULLED     = 1 << 4,
+    P2D_BODY_PARKED     = 1 << 5,
+    P2D_BODY_INACTIVE   = 1 << 6, // in_active is false, kept out of the broad phase
+    P2D_BODY_TOUCHED    = 1 << 7, // simulated during this step, needs writing back
+};
+
+// bodies with any of these flags are not integrated
+#define P2D_BODY_FROZEN (P2D_BODY_STATIC | P2D_BODY_SLEEPING | P2D_BODY_CULLED | P2D_BODY_PARKED)
+
+// a body's pose as of the end of the last step
+struct p2d_transform {
+    float x;
+    float y;
+    float rotation;
+};
+
+struct p2d_body_store {
+    int capacity;
+    int count; // live bodies
+
+    // handle -> dense index (-1 when free), dense index -> handle
+    int *index;
+    int *handle;
+
+    // freed handles waiting for reuse, and the number of handles ever handed out
+    int *free_handles;
+    int free_count;
+    int handle_count;
+
+    // handle -> last pose written back, and the one before the last step, see p2d_get_transforms
+    struct p2d_transform *transforms;
+    struct p2d_transform *previous_transforms;
+
+    // handles of the bodies that moved or fell asleep / woke up last step, see p2d_get_changed_bodies
+    int *changed;
+    int changed_count;
+    bool *reported_sleeping; // handle -> sleep state as of the last changed list
+
+    /*
+        Everything below is indexed by dense index
+    */
+
+    // hot state
+    float *x;
+    float *y;
+    float *rotation;
+    float *vx;
+    float *vy;
+    float *vr;
+    float *inv_mass;
+    float *inv_inertia;
+
+    // shape and material, refreshed every step
+    uint8_t *type;
+    float *width;   // radius for circles
+    float *height;
+    float *restitution;
+    float *static_friction;
+    float *dynamic_friction;
+    float *drag;    // air resistance factor
+
+    uint8_t *flags;
+    uint8_t *lod;
+    uint16_t *mask;
+
+    // broad phase bounds, refreshed on every rebuild
+    struct p2d_aabb *aabb;
+};
+// the active world's store is p2d_bodies, see context.h
+
+/*
+    Grow the store (and p2d_objects) to hold at least capacity bodies, or free it
+*/
+P2D_API bool p2d_bodies_reserve(int capacity);
+P2D_API void p2d_bodies_shutdown(void);
+
+/*
+    Add an object to the store and return its handle, growing the store if needed.
+    Returns -1 if it couldn't grow (p2d_create_object)
+*/
+P2D_API int p2d_body_attach(struct p2d_object *object);
+
+/*
+    Add count objects to the store at once (setting their handles), growing it once.
+    Returns false, and adds none, if it couldn't grow (p2d_create_objects)
+*/
+P2D_API bool p2d_body_attach_many(struct p2d_object *objects, int count);
+
+/*
+    Swap remove a body and free its handle (p2d_remove_object)
+*/
+P2D_API void p2d_body_detach(int handle);
+
+/*
+    Remove every body
+*/
+P2D_API void p2d_bodies_clear(void);
+
+/*
+    Current dense index of a handle, -1 if it isn't live
+*/
+P2D_API int p2d_body_index(int handle);
+
+/*
+    Copy every simulated object into the store, called at the start of p2d_step(). Sleeping and
+    static bodies nobody moved only have their material copied, their pose and bounds still hold
+*/
+P2D_API void p2d_bodies_gather(void);
+
+/*
+    Copy one body (by dense index) from its object again, bounds included
+*/
+P2D_API void p2d_body_reload(int index);
+
+/*
+    Integrate every body that isn't frozen for one substep
+*/
+P2D_API void p2d_bodies_integrate(float delta_time, int substep);
+
+/*
+    Write every body touched this step back to its object (and out pointers),
+    called at the end of p2d_step()
+*/
+P2D_API void p2d_bodies_scatter(void);
+
+/*
+    Hand a body's new pose to the engine before its object takes it: into the transform
+    buffer, and through the object's out pointers unless p2d_state.p2d_transform_output is on
+*/
+P2D_API void p2d_body_output(struct p2d_object *object, float x, float y, float rotation);
+
+/*
+    Every body's pose as of the end of the last step, indexed by handle, for engines that
+    copy poses over in one linear pass instead of through out pointers (see
+    p2d_state.p2d_transform_output). *count is set to the number of handles, entries of
+    handles that aren't live are stale. Valid until the next object is created.
+*/
+P2D_API const struct p2d_transform *p2d_get_transforms(int *count);
+
+/*
+    Every body's pose as of the start of the last step, indexed by handle like p2d_get_transforms
+*/
+P2D_API const struct p2d_transform *p2d_get_previous_transforms(int *count);
+
+/*
+    A body's pose blended p2d_state.p2d_alpha of the way from the start to the end of the last
+    step, for drawing between fixed steps (see p2d_advance)
+*/
+P2D_API struct p2d_transform p2d_get_interpolated_transform(int handle);
+
+/*
+    Handles of the bodies that moved, or fell asleep or woke up, during the last step (in no
+    particular order), so transform sync, render culling and replication can skip the rest.
+    Bodies removed since may still be listed. After p2d_snapshot_restore() it lists every body.
+*/
+P2D_API const int *p2d_get_changed_bodies(int *count);
+
+/*
+    Recompute the cached AABB of a body (by dense index) from its current pose
+*/
+P2D_API struct p2d_aabb p2d_body_update_aabb(int index);
+
+/*
+    Fill a stack object with everything the narrow phase and solver read from a body (by dense index)
+*/
+P2D_API void p2d_body_proxy(int index, struct p2d_object *out);
+
+/*
+    Store a proxy's pose / velocity back into the store
+*/
+P2D_API void p2d_body_store_pose(int index, const struct p2d_object *proxy);
+P2D_API void p2d_body_store_velocity(int index, const struct p2d_object *proxy);
+
+#endif // P2D_BODY_H
@@ -0,0 +1,155 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    World contexts.
+
+    Everything one simulation owns (settings and counters, the body store, broad phase,
+    joints, islands, regions, collision pairs, narrow phase and solver scratch, the running state hash, the last step's events and trigger overlaps, query scratch) lives in a p2d_world_t.
+
+    Every thread has an active world that the rest of the API acts on. It starts out as the
+    built in default world, so code written against the old globals keeps working as is:
+    p2d_state is still a plain variable, the default world's state, and p2d_objects,
+    p2d_bodies, p2d_joints, p2d_world... name fields of the active world. Other worlds'
+    settings are reached through p2d_get_world()->state.
+
+    To run several simulations, create more worlds and either make one active with
+    p2d_world_use() around a group of calls, or go through the p2d_world_* wrappers below.
+    Different threads may use different worlds at the same time, a single world must only
+    be used by one thread at a time.
+*/
+
+#ifndef P2D_CONTEXT_H
+#define P2D_CONTEXT_H
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+#include "p2d/body.h"
+#include "p2d/world.h"
+#include "p2d/pairs.h"
+#include "p2d/island.h"
+#include "p2d/region.h"
+#include "p2d/narrowphase.h"
+#include "p2d/solver.h"
+#include "p2d/statehash.h"
+#include "p2d/events.h"
+#include "p2d/triggers.h"
+#include "p2d/query.h"
+#include "p2d/snapshot.h"
+
+struct p2d_world_context {
+    struct p2d_state *state; // p2d_state for the default world, own_state for the rest
+    struct p2d_state own_state;
+    struct p2d_body_store bodies;
+    struct p2d_object **objects;
+    struct p2d_broadphase_store broadphase;
+    struct p2d_joint **joints;
+    struct p2d_island_store islands;
+    struct p2d_region_store regions;
+    struct p2d_pair_table pairs;
+    struct p2d_narrowphase_store narrowphase;
+    struct p2d_solver_store solver;
+    struct p2d_state_hash_store state_hash;
+    struct p2d_event_store events;
+    struct p2d_trigger_store triggers;
+    struct p2d_query_store queries;
+};
+
+typedef struct p2d_world_context p2d_world_t;
+
+/*
+    The library itself reads the active world straight out of thread local storage,
+    everyone else goes through p2d_get_world() (thread locals can't be exported from a dll).
+*/
+#ifdef P2D_BUILDING
+    extern P2D_THREAD_LOCAL p2d_world_t *p2d_active_world;
+    #define P2D_ACTIVE_WORLD p2d_active_world
+#else
+    #define P2D_ACTIVE_WORLD p2d_get_world()
+#endif
+
+// compatibility names for the active world's state
+#define p2d_bodies              (P2D_ACTIVE_WORLD->bodies)
+#define p2d_objects             (P2D_ACTIVE_WORLD->objects)
+#define p2d_joints              (P2D_ACTIVE_WORLD->joints)
+#define p2d_world               (P2D_ACTIVE_WORLD->broadphase.buckets)
+#define p2d_world_resting       (P2D_ACTIVE_WORLD->broadphase.resting)
+#define p2d_world_used          (P2D_ACTIVE_WORLD->broadphase.used)
+#define p2d_world_used_count    (P2D_ACTIVE_WORLD->broadphase.used_count)
+
+/*
+    The world this thread is currently acting on
+*/
+P2D_API p2d_world_t *p2d_get_world(void);
+
+/*
+    The built in world used by p2d_init() and friends when nothing else was made active
+*/
+P2D_API p2d_world_t *p2d_default_world(void);
+
+/*
+    Make world the active world for this thread (NULL = the default world).
+    Returns the previously active world, so calls can be nested.
+*/
+P2D_API p2d_world_t *p2d_world_use(p2d_world_t *world);
+
+/*
+    Allocate and initialize a new world, same arguments as p2d_init_with_capacity().
+    Returns NULL on failure. The active world is left unchanged.
+*/
+P2D_API p2d_world_t *p2d_world_create(
+    int cell_size,
+    void (*on_collision)(struct p2d_cb_data *data),
+    void (*on_trigger)(struct p2d_cb_data *data),
+    void (*log_fn)(int level, const char *fmt, ...),
+    const struct p2d_capacity *capacity
+);
+
+/*
+    Shut down and free a world made by p2d_world_create()
+*/
+P2D_API void p2d_world_destroy(p2d_world_t *world);
+
+/*
+    Wrappers that run the matching call on a given world, without changing the active one.
+    They cover stepping, objects, joints, regions, queries, snapshots and reading results back.
+    The lower level module calls (body store, broad phase, solver, events, ...) have none, those
+    are meant for the step itself, wrap them in p2d_world_use() if you really need them.
+*/
+P2D_API void p2d_world_step(p2d_world_t *world, float delta_time);
+P2D_API bool p2d_world_create_object(p2d_world_t *world, struct p2d_object *object);
+P2D_API bool p2d_world_remove_object(p2d_world_t *world, struct p2d_object *object);
+P2D_API bool p2d_world_create_objects(p2d_world_t *world, struct p2d_object *objects, int count);
+P2D_API bool p2d_world_remove_objects(p2d_world_t *world, struct p2d_object *objects, int count);
+P2D_API bool p2d_world_remove_all_objects(p2d_world_t *world);
+P2D_API bool p2d_world_add_joint(p2d_world_t *world, struct p2d_joint *joint);
+P2D_API void p2d_world_remove_joint(p2d_world_t *world, struct p2d_joint *joint);
+P2D_API int p2d_world_advance(p2d_world_t *world, float real_delta_time);
+P2D_API int p2d_world_add_region(p2d_world_t *world, struct p2d_aabb bounds);
+P2D_API bool p2d_world_move_region(p2d_world_t *world, int region, struct p2d_aabb bounds);
+P2D_API bool p2d_world_remove_region(p2d_world_t *world, int region);
+P2D_API bool p2d_world_raycast(p2d_world_t *world, vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, struct p2d_raycast_hit *hit);
+P2D_API int p2d_world_raycast_all(p2d_world_t *world, vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, p2d_raycast_fn callback, void *user_data);
+P2D_API int p2d_world_raycast_batch(p2d_world_t *world, const struct p2d_ray_query *rays, int count, struct p2d_raycast_hit *hits);
+P2D_API size_t p2d_world_snapshot_size(p2d_world_t *world);
+P2D_API size_t p2d_world_snapshot_save(p2d_world_t *world, void *buffer, size_t size);
+P2D_API bool p2d_world_snapshot_restore(p2d_world_t *world, const void *buffer, size_t size);
+P2D_API const struct p2d_transform *p2d_world_get_transforms(p2d_world_t *world, int *count);
+P2D_API struct p2d_transform p2d_world_get_interpolated_transform(p2d_world_t *world, int handle);
+P2D_API const struct p2d_event *p2d_world_get_events(p2d_world_t *world, int *count);
+P2D_API uint64_t p2d_world_state_hash(p2d_world_t *world);
+
+/*
+    Step count independent worlds steps times each, spread over the job system's threads
+    (see jobs.h, serial if it isn't running). Each world runs all of its steps back to back
+    on one thread, and a thread keeps the same slice of worlds from call to call as long as
+    count and the thread count don't change. Threads that run out of worlds steal from the
+    others, so uneven world sizes still balance. The worlds must all be distinct.
+*/
+P2D_API void p2d_step_worlds(p2d_world_t **worlds, int count, float delta_time, int steps);
+
+#endif // P2D_CONTEXT_H
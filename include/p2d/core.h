@@ -15,16 +15,25 @@
 
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 #include <stdint.h>
 
-// compile time parameters
-#ifndef P2D_MAX_OBJECTS
-    #define P2D_MAX_OBJECTS 2000
+/*
+    Initial capacities, used when p2d_init_with_capacity() isn't given any.
+    Objects, joints and the broad phase all grow by doubling once full.
+*/
+#ifndef P2D_DEFAULT_OBJECT_CAPACITY
+    #define P2D_DEFAULT_OBJECT_CAPACITY 256
+#endif
+
+#ifndef P2D_DEFAULT_JOINT_CAPACITY
+    #define P2D_DEFAULT_JOINT_CAPACITY 32
 #endif
 
-#ifndef P2D_MAX_JOINTS
-    #define P2D_MAX_JOINTS 500
+// the broad phase never uses fewer hash buckets than this
+#ifndef P2D_MIN_BUCKETS
+    #define P2D_MIN_BUCKETS 64
 #endif
 
 #ifndef P2D_BUCKETS
@@ -58,19 +67,76 @@
     #define P2D_DEFAULT_JOINT_SUBSTEPS 5
 #endif
 
+/*
+    Rest sleeping: an island goes to sleep once every body in it has stayed
+    under both velocity thresholds for P2D_DEFAULT_SLEEP_TIME seconds
+*/
+#ifndef P2D_DEFAULT_SLEEP_LINEAR_THRESHOLD
+    #define P2D_DEFAULT_SLEEP_LINEAR_THRESHOLD 5.0f // px/s
+#endif
+
+#ifndef P2D_DEFAULT_SLEEP_ANGULAR_THRESHOLD
+    #define P2D_DEFAULT_SLEEP_ANGULAR_THRESHOLD 5.0f // deg/s
+#endif
+
+#ifndef P2D_DEFAULT_SLEEP_TIME
+    #define P2D_DEFAULT_SLEEP_TIME 0.5f // seconds
+#endif
+
+/*
+    p2d_advance(): the fixed step it runs, and how many it may run per call before dropping time
+*/
+#ifndef P2D_DEFAULT_FIXED_DELTA_TIME
+    #define P2D_DEFAULT_FIXED_DELTA_TIME (1.0f / 60.0f)
+#endif
+
+#ifndef P2D_DEFAULT_MAX_ADVANCE_STEPS
+    #define P2D_DEFAULT_MAX_ADVANCE_STEPS 8
+#endif
+
+/*
+    Level of detail: every tier beyond the activation regions steps this many times less often
+*/
+#ifndef P2D_DEFAULT_LOD_RATE
+    #define P2D_DEFAULT_LOD_RATE 4
+#endif
+
+#ifndef P2D_DEFAULT_LOD_DISTANCE
+    #define P2D_DEFAULT_LOD_DISTANCE 500.0f // px
+#endif
+
+/*
+    Deterministic mode is on by default in builds made with P2D_DETERMINISTIC (see CMakeLists.txt)
+*/
+#ifndef P2D_DEFAULT_DETERMINISTIC
+    #ifdef P2D_DETERMINISTIC
+        #define P2D_DEFAULT_DETERMINISTIC true
+    #else
+        #define P2D_DEFAULT_DETERMINISTIC false
+    #endif
+#endif
+
 /*
     How callbacks and resolutions work:
 
     Engine will call p2d_step() every frame.
-    During p2d_step(), p2d will use the on_collision and on_trigger callbacks to notify the engine of collisions and triggers as they occur.
+    During p2d_step(), collisions and triggers are recorded into an event buffer (see p2d/events.h), one event per
+    touching pair per step.
 
     Once p2d_step() resolves, it will return a built list of simulation changes for the engine to consume and update
     in it's own ECS or other entity management system.
+
+    Objects are only read at the start of p2d_step() and written back at the end of it (the step itself runs on
+    p2d's internal body store). The on_collision and on_trigger callbacks are called for every event after that,
+    so inside them a and b already hold their state at the end of the step.
 */
 
+struct p2d_event;
+
 struct p2d_cb_data {
     struct p2d_object *a;
     struct p2d_object *b;
+    const struct p2d_event *event; // normal, depth, contacts and impulse of the pair
 };
 
 /*
@@ -88,9 +154,65 @@ struct p2d_state {
     float   p2d_mass_scaling;
     float   p2d_air_density;
 
-    // frustum sleeping
-    bool   p2d_frustum_sleeping;
-    struct p2d_obb p2d_frustum;
+    /*
+        region sleeping: objects that don't overlap any activation region (see region.h) are
+        culled (frozen in place, no collisions) until a region overlaps them again.
+    */
+    bool   p2d_region_sleeping;
+
+    /*
+        level of detail: instead of being culled right away, objects within p2d_lod_tiers * p2d_lod_distance
+        of a region are put in tier (distance / p2d_lod_distance) + 1, and tier n is only stepped every
+        p2d_lod_rate^n steps (with a matching longer delta time and fewer substeps). On the steps it skips
+        it still collides, as an immovable object. p2d_lod_tiers = 0 disables this.
+    */
+    int    p2d_lod_tiers;
+    int    p2d_lod_rate;
+    float  p2d_lod_distance;
+
+    // rest sleeping, independent of region culling
+    bool   p2d_rest_sleeping;
+    float  p2d_sleep_linear_threshold;
+    float  p2d_sleep_angular_threshold;
+    float  p2d_sleep_time;
+
+    /*
+        deterministic mode, for lockstep and rollback: touching pairs are solved in order of their
+        bodies' handles instead of the order the broad phase happened to find them in, so the result
+        only depends on the objects (and the order they were created and removed in), not on the cell
+        size, the object capacity or the number of threads. Bit identical between runs of the same
+        binary, as long as it was built with P2D_DETERMINISTIC (strict float evaluation).
+    */
+    bool   p2d_deterministic;
+
+    // keep p2d_step_hash up to date every step, see statehash.h
+    bool   p2d_state_hashing;
+
+    /*
+        write poses back only to the packed transform buffer (see p2d_get_transforms in body.h),
+        not through out_x / out_y / out_rotation, which are then never touched
+    */
+    bool   p2d_transform_output;
+
+    /*
+        triggers are checked for overlaps once per step (see triggers.h), and only against bodies
+        whose mask shares a bit with p2d_trigger_layers, all of them by default
+    */
+    uint16_t p2d_trigger_layers;
+
+    /*
+        fixed timestep for p2d_advance(), which steps at p2d_fixed_delta_time whatever rate it is
+        called at, at most p2d_max_advance_steps times per call (after that, time is dropped
+        rather than falling further and further behind)
+    */
+    float  p2d_fixed_delta_time;
+    int    p2d_max_advance_steps;
+
+    /*
+        Hard limit in bytes on the capacity driven tables (body store, islands, broad phase,
+        joints). Creating objects or joints that would need to grow past it fails. 0 = no limit
+    */
+    size_t p2d_memory_budget;
 
     // callbacks
     void (*on_collision)(struct p2d_cb_data *data);
@@ -99,16 +221,29 @@ struct p2d_state {
 
     // tracking / debug
     int p2d_object_count;
+    int p2d_object_capacity;
+    int p2d_joint_count;
+    int p2d_joint_capacity;
+    int p2d_bucket_count;
+    size_t p2d_memory_used;
     int p2d_sleeping_count;
+    int p2d_culled_count;
+    int p2d_parked_count;
+    unsigned int p2d_step_count;
+    int p2d_island_count;
     int p2d_world_node_count;
     int p2d_contact_checks;
     int p2d_contacts_found;
     int p2d_collision_pairs;
+    uint64_t p2d_step_hash; // hash of the world after the last step, while p2d_state_hashing is on
+    float p2d_accumulator;  // time p2d_advance() hasn't stepped yet, less than p2d_fixed_delta_time
+    float p2d_alpha;        // p2d_accumulator / p2d_fixed_delta_time, how far to blend from previous to current transforms
 
     // optional
     struct p2d_contact_list *out_contacts; // will be populated and cleared assuming user has filled this. user must free it themselves
 };
-extern struct p2d_state p2d_state;
+// the default world's state, see context.h for the others
+P2D_API extern struct p2d_state p2d_state;
 
 // TODO: split rects to OBB and AABB?
 enum p2d_object_type {
@@ -195,7 +330,11 @@ struct p2d_object {
     /*
         States
     */
-    bool sleeping;
+    bool sleeping;    // at rest
+    bool culled;      // outside of every activation region
+    bool parked;      // COMPUTED: far LOD tier skipping this step, behaves as static
+    int lod;          // COMPUTED: level of detail tier, 0 is stepped every step
+    float sleep_time; // COMPUTED: seconds spent under the sleep thresholds
 
     uint16_t mask;
 
@@ -210,7 +349,13 @@ struct p2d_object {
     /*
         Debug Optionals
     */
-    
+
+    /*
+        Internal bookkeeping (managed by p2d)
+    */
+    int handle;                     // stable index into the body store (see body.h), -1 when not simulated
+    struct p2d_object *island_next; // ring of the sleeping island this object belongs to
+    int cull_hash;                  // culled table bucket, only valid while culled
 };
 
 // TODO: damping
@@ -256,6 +401,8 @@ struct p2d_collision_manifold {
 
     vec2_t contact_points[2];
     int contact_count;
+
+    float impulse;  // OUT: normal impulse applied by p2d_resolve_collision()
 };
 
 /*
@@ -269,21 +416,59 @@ P2D_API bool p2d_init(
     void (*log_fn)(int level, const char *fmt, ...)
 );
 
+struct p2d_capacity {
+    int objects;            // initial object capacity, 0 = P2D_DEFAULT_OBJECT_CAPACITY
+    int joints;             // initial joint capacity, 0 = P2D_DEFAULT_JOINT_CAPACITY
+    size_t memory_budget;   // see p2d_state.p2d_memory_budget, 0 = no limit
+};
+
+/*
+    Same as p2d_init, but with explicit starting capacities and memory budget.
+    capacity may be NULL for the defaults.
+*/
+P2D_API bool p2d_init_with_capacity(
+    int cell_size,
+    void (*on_collision)(struct p2d_cb_data *data),
+    void (*on_trigger)(struct p2d_cb_data *data),
+    void (*log_fn)(int level, const char *fmt, ...),
+    const struct p2d_capacity *capacity
+);
+
 /*
     Shutdown the p2d simulation and free its memory
 */
 P2D_API bool p2d_shutdown(void);
 
 /*
-    Register a p2d object to be simulated
+    Fill in an object's computed area, mass, inertia (and their inverses) from its shape and density.
+    p2d_create_object() does this itself.
+*/
+P2D_API void p2d_object_compute_mass(struct p2d_object *object);
+
+/*
+    Register a p2d object to be simulated.
+    Fails if growing to fit it would go over p2d_state.p2d_memory_budget.
 */
 P2D_API bool p2d_create_object(struct p2d_object *object);
 
+/*
+    Register count objects (a contiguous array) at once, for level loads and spawning bursts.
+    The store grows once and statics are sorted into the broad phase in one rebuild.
+    Fails, registering none of them, if they don't fit in p2d_state.p2d_memory_budget.
+*/
+P2D_API bool p2d_create_objects(struct p2d_object *objects, int count);
+
 /*
     Remove a p2d object from the simulation
 */
 P2D_API bool p2d_remove_object(struct p2d_object *object);
 
+/*
+    Remove count objects (a contiguous array) at once, skipping any that aren't registered
+    (returns false if there were some)
+*/
+P2D_API bool p2d_remove_objects(struct p2d_object *objects, int count);
+
 /*
     Remove all objects from the simulation
 */
@@ -298,17 +483,40 @@ P2D_API bool p2d_remove_all_objects(void);
 */
 P2D_API bool p2d_should_collide(struct p2d_object *a, struct p2d_object *b);
 
+/*
+    Push two overlapping objects apart along normal, only moving the ones that aren't fixed
+*/
+P2D_API void p2d_separate_bodies(struct p2d_object *a, struct p2d_object *b, vec2_t normal, float depth);
+
+/*
+    Pack a pair's normal, depth and (up to two) contacts for p2d_resolve_collision()
+*/
+struct p2d_contact_list;
+P2D_API struct p2d_collision_manifold p2d_generate_manifold(struct p2d_object *a, struct p2d_object *b, vec2_t normal, float penetration, struct p2d_contact_list *contacts);
+
 /*
     Called externally to run one simulation step
 */
 // P2D_API struct p2d_contact_list * p2d_step(float delta_time);
 P2D_API void p2d_step(float delta_time);
 
+/*
+    Called externally with the real frame time instead of p2d_step(): runs as many fixed
+    p2d_fixed_delta_time steps as have built up (maybe none) and updates p2d_state.p2d_alpha,
+    for drawing with p2d_get_interpolated_transform(). Returns the number of steps run.
+*/
+P2D_API int p2d_advance(float real_delta_time);
+
 /*
     Helper-ish (poorly organized) functions
 */
 void p2d_for_each_intersecting_tile(struct p2d_object *object, void (*callback)(struct p2d_object *object, int tile_hash));
 
+// same as above, for when the caller already has the object's AABB
+void p2d_for_each_tile_in_aabb(struct p2d_object *object, struct p2d_aabb aabb, void (*callback)(struct p2d_object *object, int tile_hash));
+
+bool _object_intersects_tile(struct p2d_object *object, struct p2d_aabb tile);
+
 void _register_intersecting_tiles(struct p2d_object *object, int hash);
 
 void _unregister_intersecting_tiles(struct p2d_object *object, int hash);
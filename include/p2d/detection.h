@@ -11,6 +11,8 @@
 #include <stdbool.h>
 
 #include "p2d/export.h"
+#include "p2d/core.h"
+#include "p2d/types.h"
 
 P2D_API bool p2d_obb_intersects_obb(struct p2d_obb a, struct p2d_obb b);
 
@@ -18,4 +20,9 @@ P2D_API bool p2d_obb_verts_intersects_obb_verts(struct p2d_obb_verts rect1, stru
 
 P2D_API bool p2d_circle_intersects_aabb(struct p2d_circle circle, struct p2d_aabb aabb);
 
+/*
+    Whether two objects' shapes overlap, without working out by how much (for triggers)
+*/
+P2D_API bool p2d_objects_intersect(struct p2d_object *a, struct p2d_object *b);
+
 #endif // P2D_DETECTION_H
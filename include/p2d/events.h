@@ -0,0 +1,99 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Collision and trigger events.
+
+    Nothing is reported while a step runs. Every substep records the pairs it found touching into
+    a flat buffer, keeping one event per pair per step: the normal, depth and contacts of the
+    substep they overlapped the most in, and the impulse summed over all of them. Trigger pairs are
+    then sorted into enters, stays and exits (see p2d/triggers.h). Once p2d_step() has written
+    bodies back, on_collision / on_trigger are called once per event except stays (in the order the
+    pairs were first found, exits last), and the buffer stays readable with p2d_get_events() until
+    the next step starts. Callbacks may create and remove objects.
+*/
+
+#ifndef P2D_EVENTS_H
+#define P2D_EVENTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Lilith.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+
+struct p2d_narrow_manifold;
+
+enum p2d_event_type {
+    P2D_EVENT_COLLISION,
+    P2D_EVENT_TRIGGER_ENTER,
+    P2D_EVENT_TRIGGER_STAY,     // overlapped last step too, not passed to on_trigger
+    P2D_EVENT_TRIGGER_EXIT,     // no normal, depth or contacts
+};
+
+struct p2d_event {
+    enum p2d_event_type type;
+
+    // a always has the lower handle
+    struct p2d_object *a;
+    struct p2d_object *b;
+    int handle_a;
+    int handle_b;
+
+    vec2_t normal;      // from a to b (0 for triggers)
+    float depth;        // deepest penetration seen during the step (0 for triggers)
+
+    vec2_t contact_points[2];
+    int contact_count;  // 0 for triggers
+
+    float impulse;      // normal impulse applied, summed over contacts and substeps (0 for triggers)
+};
+
+struct p2d_event_slot {
+    uint64_t key;
+    int index; // event index + 1, 0 = empty
+};
+
+struct p2d_event_store {
+    struct p2d_event *events;
+    int count;
+    int capacity;
+
+    // pair key -> event, open addressing, cleared through the events
+    struct p2d_event_slot *slots;
+    int slot_capacity;
+};
+
+/*
+    The events of the last step, valid until the next one starts
+*/
+P2D_API const struct p2d_event *p2d_get_events(int *count);
+
+/*
+    Forget the last step's events, called at the start of p2d_step()
+*/
+P2D_API void p2d_events_clear(void);
+
+/*
+    Record (or merge into this step's event for the same pair) a touching pair of handles,
+    manifold may be NULL for events without contact information
+*/
+P2D_API void p2d_events_record(enum p2d_event_type type, int handle_a, int handle_b, const struct p2d_narrow_manifold *manifold, float impulse);
+
+/*
+    Call on_collision / on_trigger for every event, called at the end of p2d_step()
+*/
+P2D_API void p2d_events_dispatch(void);
+
+/*
+    Free the event buffer
+*/
+P2D_API void p2d_events_shutdown(void);
+
+#endif // P2D_EVENTS_H
@@ -14,4 +14,10 @@
     #define P2D_API
 #endif
 
+#ifdef _MSC_VER
+    #define P2D_THREAD_LOCAL __declspec(thread)
+#else
+    #define P2D_THREAD_LOCAL _Thread_local
+#endif
+
 #endif // P2D_EXPORT_H
@@ -25,6 +25,9 @@ P2D_API struct p2d_aabb p2d_get_aabb(struct p2d_object *object);
 
 P2D_API struct p2d_obb p2d_get_obb(struct p2d_object *object);
 
+// conservative AABB that skips the OBB math: a rotated rect never reaches further than (w + h) / 2 from its center
+P2D_API struct p2d_aabb p2d_get_loose_aabb(struct p2d_object *object);
+
 P2D_API bool p2d_aabbs_intersect(struct p2d_aabb a, struct p2d_aabb b);
 
 P2D_API void p2d_closest_point_on_segment_to_point(vec2_t sega, vec2_t segb, vec2_t point, vec2_t *outPoint, float *outDist);
@@ -0,0 +1,69 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Islands are groups of dynamic bodies connected through contacts or joints.
+
+    They are rebuilt every step with a union-find over the contact and joint graph,
+    and are the unit of sleeping: an island only sleeps once every body in it has
+    been at rest long enough, and touching any sleeping body wakes its whole island.
+*/
+
+#ifndef P2D_ISLAND_H
+#define P2D_ISLAND_H
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+
+/*
+    Union-find nodes are indexed by body handle, which (unlike the dense index)
+    survives bodies being removed from callbacks mid step
+*/
+struct p2d_island_store {
+    int *parent;
+    float *rest;                    // shortest rest time of any member, per root
+    struct p2d_object **head;
+    struct p2d_object **tail;
+    int capacity;
+};
+
+/*
+    Grow the per body island tables to hold at least capacity handles, or free them
+*/
+P2D_API bool p2d_islands_reserve(int capacity);
+P2D_API void p2d_islands_shutdown(void);
+
+/*
+    Reset the union-find, called once at the start of p2d_step()
+*/
+P2D_API void p2d_islands_begin(void);
+
+/*
+    Give a body created mid step an island of its own
+*/
+P2D_API void p2d_islands_add(int handle);
+
+/*
+    Merge the islands of two bodies (by handle) that are in contact (or jointed)
+*/
+P2D_API void p2d_islands_link(int a, int b);
+
+/*
+    Advance per-body rest timers and put islands that have
+    been resting long enough to sleep, called at the end of p2d_step()
+*/
+P2D_API void p2d_islands_update(float delta_time);
+
+/*
+    Wake a sleeping object along with the rest of its island.
+
+    Sleeping objects that were moved or pushed from outside p2d are woken automatically at the
+    start of the next step, this is for waking them (or culled objects) explicitly.
+*/
+P2D_API void p2d_wake_object(struct p2d_object *object);
+
+#endif // P2D_ISLAND_H
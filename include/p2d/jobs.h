@@ -0,0 +1,89 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    A small thread pool, shared by every world in the process.
+
+    Work is handed out as a parallel for over [0, count): every thread (the caller included)
+    starts on its own contiguous block of the range, so repeated calls over the same data
+    keep landing on the same threads, and once its block is done a thread steals grains
+    from the front of the others' blocks.
+
+    Without p2d_jobs_init() (or with one thread) everything runs serially on the caller.
+    Calls made from inside a job, or while another thread is using the pool, also run serially.
+    Engines with their own scheduler can take over instead, see p2d_jobs_set_scheduler().
+
+    Jobs run on the active world of the thread that started the parallel for (see context.h).
+    p2d_step() uses it for integration and the broad phase rebuild of larger worlds.
+*/
+
+#ifndef P2D_JOBS_H
+#define P2D_JOBS_H
+
+#include <stdbool.h>
+
+#include "p2d/export.h"
+
+#ifndef P2D_MAX_THREADS
+    #define P2D_MAX_THREADS 64
+#endif
+
+// bodies per grain for the parallel parts of p2d_step()
+#ifndef P2D_JOB_GRAIN
+    #define P2D_JOB_GRAIN 128
+#endif
+
+/*
+    Called with a sub range [begin, end) of the parallel for, and the index of the
+    thread running it (0 is the caller, always < p2d_jobs_thread_count())
+*/
+typedef void (*p2d_job_fn)(void *data, int begin, int end, int thread);
+
+/*
+    Hands every parallel for to the engine. parallel_for must run fn over all of [0, count)
+    (in whatever sub ranges it likes, each call given a thread index below threads)
+    and only return once it all ran.
+*/
+struct p2d_scheduler {
+    void (*parallel_for)(int count, int grain, p2d_job_fn fn, void *data, void *user);
+    int threads;
+    void *user;
+};
+
+/*
+    Start the pool with this many threads in total, counting the calling thread
+    (0 = one per hardware thread). Restarts the pool if it was already running.
+*/
+P2D_API bool p2d_jobs_init(int threads);
+
+/*
+    Stop and join the pool's threads, later parallel fors run serially
+*/
+P2D_API void p2d_jobs_shutdown(void);
+
+/*
+    Route parallel fors through the engine's scheduler, NULL goes back to the built in pool
+*/
+P2D_API void p2d_jobs_set_scheduler(const struct p2d_scheduler *scheduler);
+
+/*
+    Number of threads a parallel for may use, 1 when the pool isn't running
+*/
+P2D_API int p2d_jobs_thread_count(void);
+
+/*
+    True if a parallel for this size, started here, would be split across threads
+    (it may still run serially if another thread has the pool at the time)
+*/
+P2D_API bool p2d_jobs_parallel(int count, int grain);
+
+/*
+    Run fn over [0, count) in grains of at most grain items, returns once all of it ran
+*/
+P2D_API void p2d_parallel_for(int count, int grain, p2d_job_fn fn, void *data);
+
+#endif // P2D_JOBS_H
@@ -11,18 +11,34 @@
 #include "p2d/core.h"
 #include "p2d/export.h"
 
-extern struct p2d_joint * p2d_joints[P2D_MAX_JOINTS];
+/*
+    p2d_joints (the active world's, see context.h) is a packed list of the p2d_state.p2d_joint_count
+    registered joints, in the order they were added. Grows by doubling, within p2d_state.p2d_memory_budget.
+*/
 
 /*
     yoyoengine stores joints inside the physics component in a linked list?
 */
 
-P2D_API void p2d_add_joint(struct p2d_joint *joint);
+/*
+    Make room for at least this many joints, returns false if over the memory budget
+*/
+P2D_API bool p2d_joints_reserve(int capacity);
+
+/*
+    Returns false if the joint list couldn't grow to fit it
+*/
+P2D_API bool p2d_add_joint(struct p2d_joint *joint);
 
 P2D_API void p2d_remove_joint(struct p2d_joint *joint);
 
 P2D_API void p2d_remove_all_joints(void);
 
+/*
+    Free the joint list
+*/
+P2D_API void p2d_joints_shutdown(void);
+
 P2D_API vec2_t p2d_get_joint_world_anchor(struct p2d_object *object, vec2_t local_anchor);
 
 P2D_API void p2d_resolve_joints(float delta_time, int substeps);
@@ -0,0 +1,60 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Tracked allocations for p2d's capacity driven tables (body store, islands, broad phase
+    buckets and nodes, culled nodes, joints) and its scratch arrays (candidate and manifold
+    lists, solver batches, events, trigger overlaps, state hash terms, queries), so they can
+    be held to p2d_state.p2d_memory_budget. The running total is updated atomically, job
+    threads may grow their own arrays.
+*/
+
+#ifndef P2D_MEMORY_H
+#define P2D_MEMORY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+
+/*
+    Returns true if growing the tracked allocations by this many bytes stays within budget
+*/
+P2D_API bool p2d_memory_fits(size_t extra);
+
+/*
+    Allocate / resize / free tracked memory. Allocations past the budget return NULL,
+    new memory is zeroed.
+*/
+P2D_API void *p2d_alloc(size_t size);
+P2D_API void *p2d_realloc(void *ptr, size_t old_size, size_t new_size);
+P2D_API void p2d_free(void *ptr, size_t size);
+
+/*
+    Grow a tracked array of size byte items to hold at least needed, doubling from 256.
+    New items are zeroed. Returns false, leaving the array as it was, if that doesn't fit.
+*/
+P2D_API bool p2d_grow(void **items, int *capacity, int needed, size_t size);
+
+// one of several tracked arrays sharing a capacity, for p2d_grow_columns()
+struct p2d_column {
+    void **items;
+    size_t size; // of one item
+};
+
+// most columns p2d_grow_columns() takes at once
+#define P2D_MAX_COLUMNS 32
+
+/*
+    Grow count arrays sharing one capacity from old_capacity to new_capacity items, all or nothing:
+    every new array is allocated before any old one is let go, so if one doesn't fit (false) they
+    all keep their old size, and their capacity stays right. New items are zeroed.
+*/
+P2D_API bool p2d_grow_columns(const struct p2d_column *columns, int count, size_t old_capacity, size_t new_capacity);
+
+#endif // P2D_MEMORY_H
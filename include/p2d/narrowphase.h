@@ -0,0 +1,126 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    The narrow phase, split out of the pair loop in p2d_step().
+
+    Every substep runs in three passes:
+        1. the occupied buckets are walked (serially) into a list of candidate pairs,
+           each pair only once, in the order the buckets list them (or, in deterministic
+           mode, sorted by body handle)
+        2. every candidate is tested on the job system, a thread writes the manifolds it
+           finds into its own buffer and notes on the candidate where it put them
+        3. the solver (see solver.h) separates, resolves and calls back
+
+    Nothing in pass 2 writes to the body store, so which thread tests which pair doesn't
+    matter: the manifolds are merged back by candidate index, and the step comes out the
+    same for any number of threads.
+
+    The solver still pushes bodies apart one color at a time, so a manifold can be out of date by
+    the time its pair comes up. Separation only ever translates, so instead of testing again
+    every body's push this substep is tracked and the manifold is moved along with it.
+*/
+
+#ifndef P2D_NARROWPHASE_H
+#define P2D_NARROWPHASE_H
+
+#include <stdbool.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+#include "p2d/jobs.h"
+#include "p2d/collide.h"
+#include "p2d/contacts.h"
+
+// one of them came from the resting table, only solve the pair while that one is still asleep
+#define P2D_CANDIDATE_RESTING (1 << 0)
+
+// a sensor pair whose shapes overlap, see p2d_triggers_detect()
+#define P2D_CANDIDATE_OVERLAPPING (1 << 1)
+
+struct p2d_candidate {
+    int a;          // body store handles
+    int b;
+    int flags;
+
+    // where the narrow phase put its manifold, thread is -1 if they don't touch
+    int thread;
+    int manifold;
+};
+
+struct p2d_narrow_manifold {
+    struct p2d_collision_info info;
+
+    // at most two per pair, see p2d_generate_contacts()
+    struct p2d_contact contacts[2];
+    int contact_count;
+};
+
+// manifolds found by one job thread
+struct p2d_manifold_list {
+    struct p2d_narrow_manifold *items;
+    int count;
+    int capacity;
+    bool failed;
+};
+
+struct p2d_narrowphase_store {
+    struct p2d_candidate *candidates;
+    int candidate_count;
+    int candidate_capacity;
+
+    // pairs with a trigger in them, which never become candidates (only listed when sensing)
+    struct p2d_candidate *sensors;
+    int sensor_count;
+    int sensor_capacity;
+
+    // open addressing set of the pairs listed this substep
+    unsigned long long *seen;
+    int seen_capacity;
+    int seen_count;
+
+    struct p2d_manifold_list manifolds[P2D_MAX_THREADS];
+
+    // how far separation moved each body this substep, by handle
+    vec2_t *shift;
+    int shift_count;
+    int shift_capacity;
+};
+
+/*
+    Walk the broad phase into the candidate list, returns how many were found. With sensors,
+    pairs with a trigger in them are listed into the sensor list, otherwise they are skipped.
+*/
+P2D_API int p2d_collect_candidates(bool sensors);
+
+/*
+    Test every candidate, in parallel when the job system is running
+*/
+P2D_API void p2d_run_narrowphase(void);
+
+/*
+    The manifold found for a candidate, NULL if its bodies don't touch
+*/
+P2D_API const struct p2d_narrow_manifold *p2d_candidate_manifold(const struct p2d_candidate *candidate);
+
+/*
+    Note that separation moved a body (by handle) after the narrow phase ran
+*/
+P2D_API void p2d_narrowphase_moved(int handle, vec2_t delta);
+
+/*
+    Bring a candidate's manifold up to date with what separation has done to its bodies since.
+    Returns false if they no longer touch.
+*/
+P2D_API bool p2d_refresh_manifold(const struct p2d_candidate *candidate, struct p2d_narrow_manifold *manifold);
+
+/*
+    Free the candidate list and manifold buffers
+*/
+P2D_API void p2d_narrowphase_shutdown(void);
+
+#endif // P2D_NARROWPHASE_H
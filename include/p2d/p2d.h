@@ -21,10 +21,24 @@ extern "C" {
 #include "types.h"
 #include "core.h"
 #include "world.h"
+#include "body.h"
 #include "helpers.h"
 #include "detection.h"
 #include "contacts.h"
 #include "joint.h"
+#include "island.h"
+#include "region.h"
+#include "memory.h"
+#include "context.h"
+#include "jobs.h"
+#include "narrowphase.h"
+#include "solver.h"
+#include "snapshot.h"
+#include "statehash.h"
+#include "scene.h"
+#include "events.h"
+#include "triggers.h"
+#include "query.h"
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,124 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Scene queries.
+
+    Raycasts walk the broad phase grid cell by cell along the ray (a DDA over p2d_cell_size
+    tiles) and look at the bodies in each cell's buckets: awake, resting and static. Every body
+    found is tested once per ray, exactly, against its box or circle. The closest hit query
+    stops as soon as the cells left can't hold anything nearer.
+
+    Queries see the world as the last p2d_step() left it, which links the grid again once its last
+    solve and the joints are done: bodies created, moved by hand or reshaped since are only seen
+    after the next step. Culled and inactive bodies are not in the
+    grid, triggers are skipped, and a body the ray starts inside of is not hit.
+
+    Walking costs one bucket lookup per cell crossed, so max_distance has to be finite.
+
+    p2d_raycast_batch() answers many closest hit queries at once (hitscan, line of sight fans).
+    Every body's shape is worked out once per batch instead of once per test, the rays are sorted
+    by the tile they start in and their direction so each job walks mostly the same buckets, and
+    the bodies of each cell are tested a block of one shape at a time, out of that table. Jobs run
+    on the job system (see jobs.h) and each ray only writes its own result, so results don't
+    depend on the thread count.
+*/
+
+#ifndef P2D_QUERY_H
+#define P2D_QUERY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Lilith.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+
+// rays per job in p2d_raycast_batch()
+#ifndef P2D_RAY_GRAIN
+    #define P2D_RAY_GRAIN 64
+#endif
+
+// bodies tested together by the batch kernels
+#ifndef P2D_RAY_BLOCK
+    #define P2D_RAY_BLOCK 8
+#endif
+
+struct p2d_raycast_hit {
+    struct p2d_object *object;
+    int handle;
+
+    vec2_t point;
+    vec2_t normal;      // of the surface hit, facing back along the ray
+    float distance;     // from the origin, in px
+};
+
+struct p2d_ray_query {
+    vec2_t origin;
+    vec2_t direction;   // needn't be normalized
+    float max_distance;
+    uint16_t mask;
+};
+
+/*
+    Called for every hit of p2d_raycast_all(), nearest first. Return false to stop.
+*/
+typedef bool (*p2d_raycast_fn)(const struct p2d_raycast_hit *hit, void *user_data);
+
+// a body's shape as the batch kernels read it: a circle's center and radius (w), or a box's first corner, axes and size
+struct p2d_ray_shape {
+    float x, y;
+    float ux, uy;
+    float vx, vy;
+    float w, h;
+    bool circle;
+};
+
+struct p2d_ray_entry;
+
+struct p2d_query_store {
+    // per handle: the ray that last tested the body, so bodies in several cells are tested once
+    unsigned int *stamps;
+    int stamp_capacity;
+    unsigned int stamp;
+
+    // p2d_raycast_all() collects here before sorting
+    struct p2d_raycast_hit *hits;
+    int hit_count;
+    int hit_capacity;
+
+    // p2d_raycast_batch(): shapes by body index, and the rays in walking order
+    struct p2d_ray_shape *shapes;
+    int shape_capacity;
+    struct p2d_ray_entry *batch;
+    int batch_capacity;
+};
+
+/*
+    Closest body along the ray (direction needn't be normalized) whose mask shares a bit with
+    mask, within max_distance px. Returns false if nothing was hit.
+*/
+P2D_API bool p2d_raycast(vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, struct p2d_raycast_hit *hit);
+
+/*
+    Every body along the ray, passed to callback nearest first. Returns how many were passed.
+*/
+P2D_API int p2d_raycast_all(vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, p2d_raycast_fn callback, void *user_data);
+
+/*
+    Closest hit for each of count rays, hits[i] is rays[i]'s (handle -1 and object NULL when it
+    hit nothing). Returns how many rays hit something.
+*/
+P2D_API int p2d_raycast_batch(const struct p2d_ray_query *rays, int count, struct p2d_raycast_hit *hits);
+
+/*
+    Free the query scratch
+*/
+P2D_API void p2d_query_shutdown(void);
+
+#endif // P2D_QUERY_H
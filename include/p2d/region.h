@@ -0,0 +1,153 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Activation regions decide which parts of the world get simulated.
+
+    While p2d_state.p2d_region_sleeping is on, only objects overlapping at least one region
+    are simulated. Everything else is culled: frozen in place, not stepped, not in the broad
+    phase and not solved. A single camera is one region, a server can add one per player.
+
+    Regions live in a coarse spatial index, and culled objects live in their own table keyed by
+    where they were culled, so each step only the simulated objects are checked against the
+    index, and only moved regions look for culled objects to release.
+
+    Between fully simulated and culled there can be level of detail tiers (see p2d_lod_tiers),
+    which keep background objects alive at a fraction of the cost.
+*/
+
+#ifndef P2D_REGION_H
+#define P2D_REGION_H
+
+#include <stdbool.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+#include "p2d/types.h"
+
+#ifndef P2D_REGION_BUCKETS
+    #define P2D_REGION_BUCKETS 256
+#endif
+
+// region index cells are this many world cells wide
+#ifndef P2D_REGION_CELL_SCALE
+    #define P2D_REGION_CELL_SCALE 8
+#endif
+
+struct p2d_region {
+    struct p2d_aabb bounds;
+    bool in_use;
+    bool moved; // needs to look for culled objects to release
+};
+
+struct p2d_region_bucket {
+    int *regions;
+    int count;
+    int capacity;
+};
+
+struct p2d_region_store {
+    struct p2d_region *list;
+    int capacity;
+    bool index_dirty;
+
+    // coarse spatial index over the regions
+    struct p2d_region_bucket index[P2D_REGION_BUCKETS];
+
+    /*
+        Culled objects don't move, so each one is stored once, in the bucket of
+        the world tile its center was in when it got culled. Lookups expand their
+        area by the largest culled object so nothing that overlaps is missed.
+        Sized to p2d_state.p2d_bucket_count, see p2d_rehash_culled_objects().
+    */
+    struct p2d_world_node **culled;
+    float culled_max_extent;
+
+    bool lod_was_on;
+    float last_lod_reach;
+};
+
+/*
+    Add an activation region, returns its id or -1 on failure
+*/
+P2D_API int p2d_add_region(struct p2d_aabb bounds);
+
+/*
+    Move (or resize) an existing activation region
+*/
+P2D_API bool p2d_move_region(int region, struct p2d_aabb bounds);
+
+/*
+    Get the bounds of an existing activation region
+*/
+P2D_API bool p2d_get_region(int region, struct p2d_aabb *out_bounds);
+
+/*
+    Remove an activation region, its id may be reused
+*/
+P2D_API bool p2d_remove_region(int region);
+
+/*
+    Remove every activation region
+*/
+P2D_API void p2d_remove_all_regions(void);
+
+/*
+    Returns true if the AABB overlaps any activation region
+*/
+P2D_API bool p2d_aabb_in_any_region(struct p2d_aabb aabb);
+
+/*
+    Number of steps between two steps of a level of detail tier (p2d_lod_rate^tier)
+*/
+P2D_API int p2d_lod_period(int tier);
+
+/*
+    Cull objects that left every region and release culled objects that moved regions now cover.
+    Also (re)assigns the level of detail tier of every simulated object, and parks the ones
+    whose tier doesn't step this time.
+
+    Called once at the start of p2d_step()
+*/
+P2D_API void p2d_update_regions(void);
+
+/*
+    Cull an object where it stands (no-op if it already is), regardless of the regions.
+    Used to bring back culled objects from a snapshot.
+*/
+P2D_API void p2d_cull_object(struct p2d_object *object);
+
+/*
+    Release a culled object from the culled table (no-op if it isn't culled).
+
+    Used when removing objects. p2d_step() also releases culled objects moved or reshaped by
+    hand, the regions decide again where they are at the step after.
+*/
+P2D_API void p2d_release_culled_object(struct p2d_object *object);
+
+/*
+    Give a parked object its mass back (no-op if it isn't parked)
+*/
+P2D_API void p2d_unpark_object(struct p2d_object *object);
+
+/*
+    Release every culled object
+*/
+P2D_API void p2d_release_all_culled_objects(void);
+
+/*
+    Move the culled table to the current p2d_state.p2d_bucket_count, called by p2d_world_reserve().
+    On failure every culled object is released.
+*/
+P2D_API bool p2d_rehash_culled_objects(int old_buckets);
+
+/*
+    Release every culled object and free the culled table
+*/
+P2D_API void p2d_culled_shutdown(void);
+
+#endif // P2D_REGION_H
@@ -0,0 +1,149 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Binary scenes, for loading levels without building them object by object.
+
+    A scene file is a header followed by fixed size records: one per body, with its mass
+    properties already worked out, one per joint, and optionally the static table tiles of every
+    static body, baked for one cell size. Nothing in it needs parsing, so a scene is used straight
+    from a read only memory mapping of the file (or any buffer already in memory).
+
+    Loading a scene fills in caller owned objects and joints (p2d_object / p2d_joint are referenced
+    by pointer, like everywhere else) and registers them all at once. When the world runs with the
+    cell size the tiles were baked for, static bodies go straight into the static table instead of
+    being rasterized on the first step.
+
+    Scenes are written in the writer's byte order and loading one with another is refused.
+    Mass properties are baked with the writer's p2d_state.p2d_mass_scaling.
+*/
+
+#ifndef P2D_SCENE_H
+#define P2D_SCENE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+
+#define P2D_SCENE_MAGIC 0x4C443250u // "P2DL"
+#define P2D_SCENE_VERSION 2u
+#define P2D_SCENE_ENDIAN 0x01020304u
+
+// body record flags
+#define P2D_SCENE_BODY_STATIC   (1u << 0)
+#define P2D_SCENE_BODY_TRIGGER  (1u << 1)
+
+// joint record flags
+#define P2D_SCENE_JOINT_WORLD       (1u << 0) // b is a world anchor, not a body
+#define P2D_SCENE_JOINT_NO_COLLIDE  (1u << 1) // disable_collisions
+
+struct p2d_scene_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t endian;    // P2D_SCENE_ENDIAN as written
+
+    uint32_t body_count;
+    uint32_t joint_count;
+    uint32_t tile_count;
+    int32_t cell_size;  // cell size the static tiles were baked for, 0 if they weren't
+    uint32_t reserved;
+
+    // byte offsets from the start of the file, each 8 byte aligned
+    uint64_t bodies;        // body_count p2d_scene_body
+    uint64_t joints;        // joint_count p2d_scene_joint
+    uint64_t tile_starts;   // body_count + 1 uint32_t, body i's tiles are [tile_starts[i], tile_starts[i + 1])
+    uint64_t tiles;         // tile_count pairs of int32_t tile x, tile y
+
+    uint64_t size;          // of the whole file
+};
+
+struct p2d_scene_body {
+    uint32_t type;      // enum p2d_object_type
+    uint32_t flags;     // P2D_SCENE_BODY_*
+    uint32_t mask;
+
+    float x, y, rotation;
+    float vx, vy, vr;
+    float width, height;    // radius in width for circles
+
+    float density, restitution;
+    float static_friction, dynamic_friction;
+
+    // computed, see p2d_object_compute_mass()
+    float area;
+    float mass, inv_mass;
+    float inertia, inv_inertia;
+    float width_meters, height_meters; // radius_meters in width_meters for circles
+};
+
+struct p2d_scene_joint {
+    int32_t a;      // index of the body record
+    int32_t b;      // index of the body record, -1 if anchored to the world
+    uint32_t type;  // enum p2d_joint_type
+    uint32_t flags; // P2D_SCENE_JOINT_*
+
+    float world_anchor_b[2];
+    float local_anchor_a[2];
+    float local_anchor_b[2];
+
+    float bias_factor;
+    float rest_length;
+    float spring_constant;
+    float reserved;
+};
+
+struct p2d_scene {
+    const struct p2d_scene_header *header;
+    const struct p2d_scene_body *bodies;
+    const struct p2d_scene_joint *joints;
+    const uint32_t *tile_starts;
+    const int32_t *tiles;
+
+    int body_count;
+    int joint_count;
+
+    // set when the scene is a mapped file, see p2d_scene_close()
+    void *map;
+    size_t map_size;
+    void *file;
+    void *mapping;
+};
+
+/*
+    Write objects and joints out as a scene file. Joints may only reference objects in the
+    objects array. With bake_statics, static objects' tiles are baked for the current
+    p2d_state.p2d_cell_size. Needs an active world (for the cell size and mass scaling).
+*/
+P2D_API bool p2d_scene_write(const char *path, const struct p2d_object *objects, int count, const struct p2d_joint *joints, int joint_count, bool bake_statics);
+
+/*
+    Map a scene file read only, close it with p2d_scene_close()
+*/
+P2D_API bool p2d_scene_open(const char *path, struct p2d_scene *scene);
+
+/*
+    Use a scene that is already in memory (8 byte aligned), which must outlive the scene
+*/
+P2D_API bool p2d_scene_from_memory(const void *data, size_t size, struct p2d_scene *scene);
+
+/*
+    Fill in scene->body_count objects and scene->joint_count joints (in file order) and register
+    them with the active world. objects and joints belong to the caller and must stay alive while
+    registered, set user_data / out pointers on them afterwards.
+    Returns false (and registers nothing) if they don't fit in the memory budget.
+*/
+P2D_API bool p2d_scene_load(const struct p2d_scene *scene, struct p2d_object *objects, struct p2d_joint *joints);
+
+/*
+    Unmap a scene opened with p2d_scene_open(), does nothing to ones from memory
+*/
+P2D_API void p2d_scene_close(struct p2d_scene *scene);
+
+#endif // P2D_SCENE_H
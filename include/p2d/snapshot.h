@@ -0,0 +1,65 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    World snapshots, for rollback.
+
+    A snapshot is everything a step depends on that changes while the world runs: every registered
+    body's pose, velocity, sleep and culling state, which objects and joints are registered (and in
+    what order, with which handles), every joint's values, and the step counter. It is written into
+    a flat caller provided buffer as a handful of packed columns, so saving and restoring is a few
+    linear passes.
+
+    Saving allocates nothing. Restoring first makes sure the body store, joint table and trigger
+    pairs can hold the snapshot, growing them if they can't (which can fail over the memory budget,
+    see p2d_snapshot_restore). In the world a snapshot was saved in they always can, none of them
+    shrink before p2d_shutdown(), so that never allocates. What restoring does allocate is culled
+    table nodes for objects that have to be culled again: over the budget those objects stay
+    simulated, like any cull that doesn't fit, and the steps after no longer match.
+
+    Settings (p2d_state parameters, callbacks), activation regions and shapes / materials are not
+    part of it, they are treated as input. Contacts aren't cached between steps (the solver has no
+    warm starting), so there are no impulses to save either. Trigger overlaps are saved, so a step
+    after a restore reports the same enters and exits.
+
+    Objects and joints are referenced by pointer, restoring brings back the set that was registered
+    when the snapshot was saved: anything registered since is dropped, and anything removed since is
+    registered again, so it must still be alive. Snapshots are only valid in the world (and process)
+    they were saved in, and must be saved and restored between steps, not from callbacks.
+
+    A step after a restore comes out bit identical to the step that followed the save.
+*/
+
+#ifndef P2D_SNAPSHOT_H
+#define P2D_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+
+/*
+    Bytes a snapshot of the world needs right now
+*/
+P2D_API size_t p2d_snapshot_size(void);
+
+/*
+    Save the world into buffer, returns the bytes written or 0 if size is too small
+    (see p2d_snapshot_size). buffer must be 8 byte aligned (anything from malloc is).
+*/
+P2D_API size_t p2d_snapshot_save(void *buffer, size_t size);
+
+/*
+    Put the world back the way it was when buffer was saved.
+    Returns false (and leaves the world alone) if buffer isn't a snapshot or the
+    world couldn't grow back to its size (only possible with a snapshot of a bigger
+    world than this one has ever been). May allocate culled table nodes, see above.
+*/
+P2D_API bool p2d_snapshot_restore(const void *buffer, size_t size);
+
+#endif // P2D_SNAPSHOT_H
@@ -0,0 +1,108 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    The contact and joint solver.
+
+    Constraints are greedily colored so that no two in the same color share a body that can
+    move, static bodies are only ever read so they never conflict. Colors are solved one after
+    another, the constraints inside a color in parallel on the job system.
+
+    The coloring only depends on the order constraints are listed in, so the order they are
+    solved in (and so the result) is the same however many threads there are, one included.
+
+    Contacts go through three passes every substep:
+        1. serially, in candidate order: filtering, waking and island links
+        2. colored: separation and resolution
+        3. serially, in candidate order: contact stats and collision events
+    Callbacks only run once the step is over (see p2d/events.h), so nothing is added or removed
+    while contacts are solved.
+*/
+
+#ifndef P2D_SOLVER_H
+#define P2D_SOLVER_H
+
+#include <stdbool.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+#include "p2d/narrowphase.h"
+
+// constraints per grain when a color is split across threads
+#ifndef P2D_SOLVER_GRAIN
+    #define P2D_SOLVER_GRAIN 32
+#endif
+
+// colors tracked per body, constraints that don't fit in any are solved serially after the rest
+#define P2D_MAX_COLORS 64
+
+struct p2d_contact_constraint {
+    int candidate;
+    int a;          // body store indices, fixed from the coloring to the end of the substep
+    int b;
+
+    bool resolved;  // still touching when its color came up, and had contacts
+    struct p2d_narrow_manifold manifold; // as it was when solved
+    float impulse;  // normal impulse it was resolved with
+};
+
+struct p2d_color_batches {
+    int *order;     // constraint indices, grouped by color
+    int capacity;
+
+    // color c is order[start[c] .. start[c + 1]), the last one is the serial overflow
+    int start[P2D_MAX_COLORS + 2];
+};
+
+struct p2d_solver_store {
+    struct p2d_contact_constraint *contacts;
+    int contact_count;
+    int contact_capacity;
+
+    // 2 body handles per constraint, -1 for ones that don't conflict
+    int *bodies;
+    int body_capacity;
+
+    // colors already taken around each body, by handle
+    unsigned long long *taken;
+    int taken_capacity;
+
+    // color of each constraint, while sorting them into batches
+    int *colors;
+    int colors_capacity;
+
+    struct p2d_color_batches contact_batches;
+    struct p2d_color_batches joint_batches;
+};
+
+/*
+    Room for 2 body handles per constraint for count constraints, NULL if out of memory
+*/
+P2D_API int *p2d_constraint_bodies(int count);
+
+/*
+    Color count constraints, given as 2 body handles each (-1 = doesn't conflict).
+    Returns false (and leaves batches alone) if out of memory.
+*/
+P2D_API bool p2d_color_constraints(const int *bodies, int count, struct p2d_color_batches *batches);
+
+/*
+    Run fn over every constraint, one color at a time, see p2d_parallel_for()
+*/
+P2D_API void p2d_solve_batches(const struct p2d_color_batches *batches, p2d_job_fn fn, void *data);
+
+/*
+    Separate, resolve and report everything the narrow phase found this substep
+*/
+P2D_API void p2d_solve_contacts(void);
+
+/*
+    Free the solver's scratch
+*/
+P2D_API void p2d_solver_shutdown(void);
+
+#endif // P2D_SOLVER_H
@@ -0,0 +1,97 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    State hashing, for desync detection between lockstep peers.
+
+    The hash covers every registered body's handle, position, rotation, velocities and whether
+    it is asleep, exactly as stored (bit patterns, not values). Contacts aren't kept between
+    steps, so there is no contact cache to cover.
+
+    It is a sum of one mixed 64 bit term per body, so it doesn't depend on the order bodies are
+    stored in, and can be kept up to date a body at a time: with p2d_state.p2d_state_hashing on,
+    every step only rehashes the bodies that step could have changed (not the ones that stayed
+    asleep or culled) and leaves the result in p2d_state.p2d_step_hash.
+
+    The world is also split into P2D_HASH_REGIONS sub-hashes, by coarse cell of each body's
+    position, so when two peers disagree comparing those tells which part of the world went
+    wrong first (see p2d_state_hash_region for which cells a sub-hash covers).
+*/
+
+#ifndef P2D_STATEHASH_H
+#define P2D_STATEHASH_H
+
+#include <stdint.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+
+// number of sub-hashes, a power of two
+#ifndef P2D_HASH_REGIONS
+    #define P2D_HASH_REGIONS 64
+#endif
+
+// sub-hash cells are this many world cells wide
+#ifndef P2D_HASH_REGION_SCALE
+    #define P2D_HASH_REGION_SCALE 16
+#endif
+
+// a body's share of the running hash, counted is false until it has one
+struct p2d_state_hash_term {
+    uint64_t term;
+    uint8_t region;
+    bool counted;
+};
+
+struct p2d_state_hash_store {
+    // per handle
+    struct p2d_state_hash_term *terms;
+    int capacity;
+
+    uint64_t sums[P2D_HASH_REGIONS];
+    int counts[P2D_HASH_REGIONS];
+
+    bool valid; // terms match the world, otherwise the next update starts over
+};
+
+/*
+    Hash the whole world now, from scratch. After a step this is the same value as
+    p2d_state.p2d_step_hash (when hashing is on).
+*/
+P2D_API uint64_t p2d_state_hash(void);
+
+/*
+    Hash the whole world now, one value per sub-hash region
+*/
+P2D_API void p2d_state_hash_regions(uint64_t out[P2D_HASH_REGIONS]);
+
+/*
+    Which sub-hash a body at this position counts towards
+*/
+P2D_API int p2d_state_hash_region(float x, float y);
+
+/*
+    Bring p2d_state.p2d_step_hash up to date, called at the end of p2d_step() while hashing is on
+*/
+P2D_API void p2d_state_hash_update(void);
+
+/*
+    Take a body (by handle) out of the running hash, called when it is removed
+*/
+P2D_API void p2d_state_hash_forget(int handle);
+
+/*
+    Throw the running hash away, the next update rehashes every body
+*/
+P2D_API void p2d_state_hash_invalidate(void);
+
+/*
+    Free the running hash
+*/
+P2D_API void p2d_state_hash_shutdown(void);
+
+#endif // P2D_STATEHASH_H
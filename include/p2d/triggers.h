@@ -0,0 +1,94 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Trigger overlap tracking.
+
+    Triggers skip the contact pipeline altogether. Once per step, on the last substep, every pair
+    the broad phase finds with a trigger in it (and the other body on p2d_state.p2d_trigger_layers)
+    gets an AABB check and a yes / no shape test, no normal, depth or contacts, and each overlapping
+    one is recorded as a P2D_EVENT_TRIGGER_STAY event. At the end of the step those are compared
+    with the pairs that overlapped as of the step before: new pairs become P2D_EVENT_TRIGGER_ENTER,
+    and pairs that stopped overlapping get a P2D_EVENT_TRIGGER_EXIT. on_trigger is only called for
+    enter and exit, stays are left in the event buffer and in the overlap set for whoever asks.
+
+    A pair that isn't found again is kept while neither body was simulated that step (both asleep,
+    static or culled), so a body falling asleep inside a zone doesn't leave it. Removing a body drops
+    its overlaps without an exit event, its object may already be gone.
+*/
+
+#ifndef P2D_TRIGGERS_H
+#define P2D_TRIGGERS_H
+
+#include <stdbool.h>
+
+#include "p2d/export.h"
+#include "p2d/core.h"
+
+// body store handles, a < b
+struct p2d_trigger_pair {
+    int a;
+    int b;
+};
+
+struct p2d_trigger_store {
+    // overlapping as of the end of the last step, sorted
+    struct p2d_trigger_pair *pairs;
+    int count;
+    int capacity;
+
+    // scratch for the next set, and this step's stay events in pair order
+    struct p2d_trigger_pair *next;
+    int next_capacity;
+    int *order;
+    int order_capacity;
+};
+
+/*
+    Every pair overlapping a trigger as of the end of the last step, sorted by handles
+*/
+P2D_API const struct p2d_trigger_pair *p2d_get_trigger_overlaps(int *count);
+
+/*
+    Whether a and b (one of them a trigger) overlapped as of the end of the last step
+*/
+P2D_API bool p2d_trigger_overlapping(struct p2d_object *a, struct p2d_object *b);
+
+/*
+    Test the sensor pairs listed by p2d_collect_candidates(true) and record the overlapping ones as
+    stay events, called on the last substep
+*/
+P2D_API void p2d_triggers_detect(void);
+
+/*
+    Turn this step's trigger events into enters, stays and exits, called at the end of p2d_step()
+    before bodies are written back
+*/
+P2D_API void p2d_triggers_update(void);
+
+/*
+    Drop a body's (by handle) overlaps, called when it is removed
+*/
+P2D_API void p2d_triggers_forget(int handle);
+
+/*
+    Replace the overlap set, for snapshot restores. pairs must be sorted.
+    Returns false (and changes nothing) if it doesn't fit.
+*/
+P2D_API bool p2d_triggers_restore(const struct p2d_trigger_pair *pairs, int count);
+
+/*
+    Forget every overlap
+*/
+P2D_API void p2d_triggers_clear(void);
+
+/*
+    Free the overlap set
+*/
+P2D_API void p2d_triggers_shutdown(void);
+
+#endif // P2D_TRIGGERS_H
@@ -9,36 +9,119 @@
 #define P2D_WORLD_H
 
 #include "p2d/core.h"
+#include "p2d/jobs.h"
 
 struct p2d_world_node {
     struct p2d_object *object;
+    int handle; // body store handle of object
     struct p2d_world_node *next;
 };
 
 /*
-    Explanation of the world representation:
-    The hash table contains world tiles, that each contain lists of objects in their tiles.
+    Nodes come from chunked pools instead of one malloc each, chunks never move
+    (nodes point at each other) and are kept around until shutdown.
 */
-extern struct p2d_world_node *p2d_world[P2D_MAX_OBJECTS];
+struct p2d_world_pool {
+    struct p2d_world_chunk *head;
+    struct p2d_world_chunk *current;
+};
 
 /*
-    Also keep a reference to all objects in the world, that doesnt require accessing
-    spatially
+    Explanation of the world representation:
+    The hash table (p2d_world) contains world tiles, that each contain lists of objects in their tiles.
+    It has p2d_state.p2d_bucket_count buckets, grown alongside the body store.
+
+    Buckets of p2d_world used since the last p2d_world_remove_all() are listed in p2d_world_used,
+    so the broad phase only walks occupied buckets. A listed bucket may have been emptied since.
+
+    Sleeping objects don't move, so instead of being re-registered every substep they
+    live in a second table (p2d_world_resting) that is only rebuilt when the set of sleeping
+    objects changes. Awake objects are still tested against it, so they can land on (and wake)
+    sleeping piles.
+
+    Static objects get a third table of their own (p2d_broadphase.statics), which is only rebuilt
+    when a static object is added, removed, moved, reshaped, culled or deactivated. It can also be
+    filled straight from tiles baked ahead of time (see scene.h).
+
+    Also keep a reference to all objects in the world (p2d_objects), that doesnt require accessing
+    spatially. It is packed: the first p2d_state.p2d_object_count entries are the live
+    objects, in the same order as the body store (see body.h).
+
+    All of these belong to the active world, see context.h.
 */
-extern struct p2d_object * p2d_objects[P2D_MAX_OBJECTS];
+
+// a run of bodies [begin, ...) whose tiles sit in tile_lists[thread].tiles[first], count entries
+struct p2d_tile_span {
+    int begin;
+    int thread;
+    int first;
+    int count;
+};
+
+// tiles found by one job thread during a parallel rebuild, as body index, hash pairs
+struct p2d_tile_list {
+    int *tiles;
+    int count;
+    int capacity;
+
+    struct p2d_tile_span *spans;
+    int span_count;
+    int span_capacity;
+
+    int sleeping;
+    bool failed;
+};
+
+struct p2d_broadphase_store {
+    struct p2d_world_node **buckets;
+    struct p2d_world_node **resting;
+    struct p2d_world_node **statics;
+
+    int *used;
+    int used_count;
+    bool *used_listed;
+
+    bool resting_dirty;
+    bool statics_dirty;
+    bool link_failed; // a node pool couldn't grow during this rebuild, some body is missing
+    int reserve_attempted; // body capacity the buckets last tried to grow to
+
+    struct p2d_world_pool nodes;
+    struct p2d_world_pool resting_nodes;
+    struct p2d_world_pool static_nodes;
+
+    // scratch for p2d_rebuild_world() when it runs on the job system
+    struct p2d_tile_list tile_lists[P2D_MAX_THREADS];
+    struct p2d_tile_span *merged_spans;
+    int merged_capacity;
+};
 
 /*
     Converts an object's position to a hash bucket tile index
 */
 P2D_API int p2d_world_hash(int tile_x, int tile_y);
 
+/*
+    Grow the hash tables to at least this many buckets (never fewer than P2D_MIN_BUCKETS).
+    Clears both tables and rehashes culled objects, returns false if over the memory budget.
+*/
+P2D_API bool p2d_world_reserve(int buckets);
+
+/*
+    Free the hash tables and their node pools
+*/
+P2D_API void p2d_world_shutdown(void);
+
 /*
     Inserts an object into the world
 
     Uses the hash table under the hood to place
-    the object in it's world tile bucket
+    the object in it's world tile bucket.
+
+    Objects are registered by handle, so a body store proxy inserts the object it stands in for.
+    Returns false if it couldn't be inserted (out of memory).
 */
-P2D_API void p2d_world_insert(int world_hash, struct p2d_object *object);
+P2D_API bool p2d_world_insert(int world_hash, struct p2d_object *object);
 
 /*
     Removes an object from the world
@@ -54,8 +137,42 @@ P2D_API void p2d_world_remove(int world_hash, struct p2d_object *object);
 P2D_API void p2d_world_remove_all(void);
 
 /*
-    Rebuild the world state for broad phase collision detection
+    Unmap every object from the resting hash table
+*/
+P2D_API void p2d_world_remove_all_resting(void);
+
+/*
+    Flag the resting table for a rebuild, called whenever objects fall asleep or wake up
+*/
+P2D_API void p2d_world_mark_resting_dirty(void);
+
+/*
+    Unmap every object from the static hash table
+*/
+P2D_API void p2d_world_remove_all_statics(void);
+
+/*
+    Flag the static table for a rebuild, called whenever a static object changes
+*/
+P2D_API void p2d_world_mark_statics_dirty(void);
+
+/*
+    Put a static body (by dense index) in the static table at a given tile, for
+    tiles worked out ahead of time. Only use while the table isn't dirty.
+*/
+P2D_API void p2d_world_insert_static(int body, int tile_x, int tile_y);
+
+/*
+    Grow the tables to about one bucket per body the store has room for, if that wasn't
+    tried at this capacity yet. p2d_rebuild_world() does this every substep.
+*/
+P2D_API void p2d_world_fit_bodies(void);
+
+/*
+    Rebuild the world state for broad phase collision detection. Returns false if the node pools
+    ran out of memory, the bodies they couldn't hold are missing from the broad phase until a
+    later rebuild fits them (the resting and static tables retry on the next one).
 */
-P2D_API void p2d_rebuild_world(void);
+P2D_API bool p2d_rebuild_world(void);
 
 #endif // P2D_WORLD_H
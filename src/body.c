@@ -0,0 +1,662 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/jobs.h"
+#include "p2d/context.h"
+#include "p2d/world.h"
+#include "p2d/memory.h"
+#include "p2d/island.h"
+#include "p2d/region.h"
+#include "p2d/helpers.h"
+#include "p2d/statehash.h"
+#include "p2d/triggers.h"
+#include "internal.h"
+
+// every per body column, moved together on swap remove
+#define P2D_BODY_ARRAYS(X) \
+    X(float, x) \
+    X(float, y) \
+    X(float, rotation) \
+    X(float, vx) \
+    X(float, vy) \
+    X(float, vr) \
+    X(float, inv_mass) \
+    X(float, inv_inertia) \
+    X(uint8_t, type) \
+    X(float, width) \
+    X(float, height) \
+    X(float, restitution) \
+    X(float, static_friction) \
+    X(float, dynamic_friction) \
+    X(float, drag) \
+    X(uint8_t, flags) \
+    X(uint8_t, lod) \
+    X(uint16_t, mask) \
+    X(struct p2d_aabb, aabb)
+
+// handle bookkeeping
+#define P2D_HANDLE_ARRAYS(X) \
+    X(int, index) \
+    X(int, handle) \
+    X(int, free_handles) \
+    X(struct p2d_transform, transforms) \
+    X(struct p2d_transform, previous_transforms) \
+    X(int, changed) /* a list of handles, not indexed by them */ \
+    X(bool, reported_sleeping)
+
+// bytes one body slot costs across every column
+static size_t _p2d_body_slot_size(void) {
+    size_t size = sizeof(struct p2d_object *); // p2d_objects
+    #define X(type, name) \
+        size += sizeof(type);
+    P2D_BODY_ARRAYS(X)
+    P2D_HANDLE_ARRAYS(X)
+    #undef X
+    return size;
+}
+
+bool p2d_bodies_reserve(int capacity) {
+    struct p2d_body_store *s = &p2d_bodies;
+
+    if(capacity <= s->capacity) {
+        return true;
+    }
+
+    size_t old_capacity = (size_t)s->capacity;
+    size_t new_capacity = (size_t)capacity;
+
+    // the old columns are only let go once all the new ones exist
+    if(!p2d_memory_fits(new_capacity * _p2d_body_slot_size())) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_bodies_reserve: %d bodies would exceed the memory budget.\n", capacity);
+        return false;
+    }
+
+    // bodies created mid step need an island slot right away
+    if(!p2d_islands_reserve(capacity)) {
+        return false;
+    }
+
+    const struct p2d_column columns[] = {
+        #define X(type, name) {(void **)&s->name, sizeof(type)},
+        P2D_BODY_ARRAYS(X)
+        P2D_HANDLE_ARRAYS(X)
+        #undef X
+        {(void **)&p2d_objects, sizeof(struct p2d_object *)}
+    };
+    if(!p2d_grow_columns(columns, (int)(sizeof(columns) / sizeof(columns[0])), old_capacity, new_capacity)) {
+        return false;
+    }
+
+    s->capacity = capacity;
+    p2d_state.p2d_object_capacity = capacity;
+    return true;
+}
+
+void p2d_bodies_shutdown(void) {
+    struct p2d_body_store *s = &p2d_bodies;
+    size_t capacity = (size_t)s->capacity;
+
+    #define X(type, name) \
+        p2d_free(s->name, capacity * sizeof(type));
+    P2D_BODY_ARRAYS(X)
+    P2D_HANDLE_ARRAYS(X)
+    #undef X
+    p2d_free(p2d_objects, capacity * sizeof(struct p2d_object *));
+
+    p2d_objects = NULL;
+    p2d_bodies = (struct p2d_body_store){0};
+    p2d_state.p2d_object_capacity = 0;
+
+    p2d_islands_shutdown();
+}
+
+//
+// OBJECT <-> STORE
+//
+
+static float _p2d_drag_factor(struct p2d_object *object) {
+    float drag_coefficient;
+    float xc_area;
+    switch(object->type) {
+        case P2D_OBJECT_RECTANGLE:
+            drag_coefficient = 2.05f;
+            xc_area = object->rectangle.width_meters * object->rectangle.height_meters;
+            break;
+        case P2D_OBJECT_CIRCLE:
+            drag_coefficient = 1.17f;
+            xc_area = (float)M_PI * object->circle.radius_meters * object->circle.radius_meters;
+            break;
+        default:
+            return 0.0f;
+    }
+
+    xc_area *= p2d_state.p2d_mass_scaling;
+
+    // same formula as _p2d_apply_air_resistance, minus the squared velocity
+    return 0.5f * p2d_state.p2d_air_density * drag_coefficient * xc_area;
+}
+
+static uint8_t _p2d_body_flags(struct p2d_object *object) {
+    uint8_t flags = P2D_BODY_ALIVE;
+
+    if(object->is_static)
+        flags |= P2D_BODY_STATIC;
+    if(object->is_trigger)
+        flags |= P2D_BODY_TRIGGER;
+    if(object->sleeping)
+        flags |= P2D_BODY_SLEEPING;
+    if(object->culled)
+        flags |= P2D_BODY_CULLED;
+    if(object->parked)
+        flags |= P2D_BODY_PARKED;
+    if(object->in_active && !*object->in_active)
+        flags |= P2D_BODY_INACTIVE;
+
+    if(!(flags & (P2D_BODY_STATIC | P2D_BODY_SLEEPING | P2D_BODY_CULLED)))
+        flags |= P2D_BODY_TOUCHED;
+
+    return flags;
+}
+
+// everything but the pose and shape, cheap enough to copy for every body every step
+static void _p2d_body_load_material(int i, struct p2d_object *object) {
+    struct p2d_body_store *s = &p2d_bodies;
+
+    s->inv_mass[i] = object->inv_mass;
+    s->inv_inertia[i] = object->inv_inertia;
+    s->restitution[i] = object->restitution;
+    s->static_friction[i] = object->static_friction;
+    s->dynamic_friction[i] = object->dynamic_friction;
+    s->drag[i] = _p2d_drag_factor(object);
+
+    s->flags[i] = _p2d_body_flags(object);
+    s->lod[i] = (uint8_t)object->lod;
+    s->mask[i] = object->mask;
+}
+
+static void _p2d_body_load(int i, struct p2d_object *object) {
+    struct p2d_body_store *s = &p2d_bodies;
+
+    s->x[i] = object->x;
+    s->y[i] = object->y;
+    s->rotation[i] = object->rotation;
+    s->vx[i] = object->is_static ? 0.0f : object->vx;
+    s->vy[i] = object->is_static ? 0.0f : object->vy;
+    s->vr[i] = object->vr;
+
+    s->type[i] = (uint8_t)object->type;
+    if(object->type == P2D_OBJECT_RECTANGLE) {
+        s->width[i] = object->rectangle.width;
+        s->height[i] = object->rectangle.height;
+    }
+    else {
+        s->width[i] = object->circle.radius;
+        s->height[i] = object->circle.radius;
+    }
+
+    _p2d_body_load_material(i, object);
+}
+
+// doubles until count more bodies fit, all at once
+static bool _p2d_bodies_grow(int count) {
+    struct p2d_body_store *s = &p2d_bodies;
+    if(s->count + count <= s->capacity) {
+        return true;
+    }
+
+    int capacity = s->capacity > 0 ? s->capacity : P2D_DEFAULT_OBJECT_CAPACITY;
+    while(capacity < s->count + count) {
+        capacity *= 2;
+    }
+    return p2d_bodies_reserve(capacity);
+}
+
+static int _p2d_body_link(struct p2d_object *object) {
+    struct p2d_body_store *s = &p2d_bodies;
+
+    int handle = s->free_count > 0 ? s->free_handles[--s->free_count] : s->handle_count++;
+    int i = s->count++;
+
+    s->index[handle] = i;
+    s->handle[i] = handle;
+    s->transforms[handle] = (struct p2d_transform){object->x, object->y, object->rotation};
+    s->previous_transforms[handle] = s->transforms[handle];
+    s->reported_sleeping[handle] = object->sleeping;
+    p2d_objects[i] = object;
+
+    _p2d_body_load(i, object);
+    p2d_body_update_aabb(i);
+
+    // it may be created from a callback, in the middle of a step
+    p2d_islands_add(handle);
+
+    return handle;
+}
+
+int p2d_body_attach(struct p2d_object *object) {
+    if(!_p2d_bodies_grow(1)) {
+        return -1;
+    }
+
+    if(object->is_static) {
+        p2d_world_mark_statics_dirty();
+    }
+
+    return _p2d_body_link(object);
+}
+
+bool p2d_body_attach_many(struct p2d_object *objects, int count) {
+    if(!_p2d_bodies_grow(count)) {
+        return false;
+    }
+
+    bool statics = false;
+    for(int i = 0; i < count; i++) {
+        objects[i].handle = _p2d_body_link(&objects[i]);
+        statics |= objects[i].is_static;
+    }
+
+    if(statics) {
+        p2d_world_mark_statics_dirty();
+    }
+    return true;
+}
+
+void p2d_body_detach(int handle) {
+    struct p2d_body_store *s = &p2d_bodies;
+
+    int i = p2d_body_index(handle);
+    if(i < 0) {
+        return;
+    }
+
+    p2d_state_hash_forget(handle);
+    p2d_triggers_forget(handle);
+
+    // its nodes would outlive the handle
+    if(s->flags[i] & P2D_BODY_STATIC) {
+        p2d_world_mark_statics_dirty();
+    }
+
+    // swap the last body into the hole
+    int last = --s->count;
+    if(i != last) {
+        #define X(type, name) \
+            s->name[i] = s->name[last];
+        P2D_BODY_ARRAYS(X)
+        #undef X
+
+        s->handle[i] = s->handle[last];
+        s->index[s->handle[i]] = i;
+        p2d_objects[i] = p2d_objects[last];
+    }
+
+    p2d_objects[last] = NULL;
+    s->index[handle] = -1;
+    s->free_handles[s->free_count++] = handle;
+}
+
+void p2d_bodies_clear(void) {
+    struct p2d_body_store *s = &p2d_bodies;
+
+    for(int i = 0; i < s->count; i++) {
+        p2d_objects[i]->handle = -1;
+        p2d_objects[i] = NULL;
+    }
+
+    s->count = 0;
+    s->free_count = 0;
+    s->handle_count = 0;
+    s->changed_count = 0;
+
+    p2d_state_hash_invalidate();
+    p2d_triggers_clear();
+}
+
+int p2d_body_index(int handle) {
+    if(handle < 0 || handle >= p2d_bodies.handle_count) {
+        return -1;
+    }
+    return p2d_bodies.index[handle];
+}
+
+// true if the user moved or pushed a sleeping object since it was last written back
+static bool _p2d_body_was_disturbed(int i, struct p2d_object *object) {
+    struct p2d_body_store *s = &p2d_bodies;
+    return object->x != s->x[i] || object->y != s->y[i] || object->rotation != s->rotation[i] ||
+           object->vx != s->vx[i] || object->vy != s->vy[i] || object->vr != s->vr[i];
+}
+
+// true if a static or culled object's pose or shape no longer matches where the tables have it
+static bool _p2d_body_was_reshaped(int i, struct p2d_object *object) {
+    struct p2d_body_store *s = &p2d_bodies;
+    if(s->type[i] != (uint8_t)object->type || object->x != s->x[i] || object->y != s->y[i] || object->rotation != s->rotation[i]) {
+        return true;
+    }
+
+    if(object->type == P2D_OBJECT_RECTANGLE) {
+        return object->rectangle.width != s->width[i] || object->rectangle.height != s->height[i];
+    }
+    return object->circle.radius != s->width[i];
+}
+
+void p2d_bodies_gather(void) {
+    struct p2d_body_store *s = &p2d_bodies;
+    uint8_t placement = P2D_BODY_STATIC | P2D_BODY_CULLED | P2D_BODY_INACTIVE;
+    bool statics_changed = false;
+
+    // wakes first, a pushed body wakes its whole island, which may sit anywhere in the store
+    for(int i = 0; i < s->count; i++) {
+        struct p2d_object *object = p2d_objects[i];
+        if(object->culled) {
+            // moved by hand, the culled table still has it where it was, so it takes part in
+            // this step and the regions decide again at the next one
+            if(_p2d_body_was_reshaped(i, object)) {
+                p2d_wake_object(object);
+            }
+        }
+        else if(object->sleeping && (s->flags[i] & P2D_BODY_SLEEPING) && _p2d_body_was_disturbed(i, object)) {
+            p2d_wake_object(object);
+        }
+    }
+
+    for(int i = 0; i < s->count; i++) {
+        struct p2d_object *object = p2d_objects[i];
+        uint8_t old_flags = s->flags[i];
+
+        // frozen in place, nothing below reads it until it is released
+        if(object->culled) {
+            s->flags[i] = P2D_BODY_ALIVE | P2D_BODY_CULLED;
+            statics_changed |= (old_flags & placement) == P2D_BODY_STATIC;
+            continue;
+        }
+
+        // still asleep or static and left where it was, its pose and bounds in the store hold
+        if((old_flags & (P2D_BODY_SLEEPING | P2D_BODY_STATIC)) && !_p2d_body_was_reshaped(i, object)) {
+            _p2d_body_load_material(i, object);
+            if(s->flags[i] == old_flags) {
+                continue;
+            }
+        }
+
+        // static bodies are never written back, so this is where moving one by hand shows up (culled or not)
+        if(object->is_static && _p2d_body_was_reshaped(i, object)) {
+            statics_changed = true;
+            // teleported, not moved, so there's nothing to blend from
+            s->transforms[s->handle[i]] = (struct p2d_transform){object->x, object->y, object->rotation};
+            s->previous_transforms[s->handle[i]] = s->transforms[s->handle[i]];
+        }
+
+        _p2d_body_load(i, object);
+
+        // awake bounds are refreshed by p2d_rebuild_world, static ones by the static rebuild marked below
+        uint8_t flags = s->flags[i];
+        if((flags & (P2D_BODY_SLEEPING | P2D_BODY_STATIC)) == P2D_BODY_SLEEPING) {
+            p2d_body_update_aabb(i);
+            // reshaped in its sleep, its resting table nodes are stale
+            if(old_flags & P2D_BODY_SLEEPING) {
+                p2d_world_mark_resting_dirty();
+            }
+        }
+
+        if(((old_flags ^ flags) & placement) && ((old_flags | flags) & P2D_BODY_STATIC)) {
+            statics_changed = true;
+        }
+    }
+
+    if(statics_changed) {
+        p2d_world_mark_statics_dirty();
+    }
+}
+
+void p2d_body_reload(int index) {
+    _p2d_body_load(index, p2d_objects[index]);
+    p2d_body_update_aabb(index);
+}
+
+//
+// INTEGRATION
+//
+
+static void _p2d_body_integrate(struct p2d_body_store *s, int i, vec2_t gravity, float dt) {
+    // apply gravity
+    float vx = s->vx[i] + gravity.x * dt;
+    float vy = s->vy[i] + gravity.y * dt;
+
+    // apply air resistance
+    vx -= (s->drag[i] * (vx * vx)) * dt;
+    vy -= (s->drag[i] * (vy * vy)) * dt;
+
+    s->vx[i] = vx;
+    s->vy[i] = vy;
+
+    // update position
+    s->x[i] += vx * dt;
+    s->y[i] += vy * dt;
+    s->rotation[i] += s->vr[i] * dt;
+}
+
+/*
+    Level of detail tiers run fewer, longer substeps (covering their whole period),
+    spread evenly across the substeps of the step they are due in
+*/
+static void _p2d_body_integrate_lod(struct p2d_body_store *s, int i, vec2_t gravity, float delta_time, int substep) {
+    int period = p2d_lod_period(s->lod[i]);
+    int substeps = p2d_state.p2d_substeps / period;
+    if(substeps < 1) {
+        substeps = 1;
+    }
+
+    int stride = p2d_state.p2d_substeps / substeps;
+    if(substep % stride != 0 || substep / stride >= substeps) {
+        return;
+    }
+
+    _p2d_body_integrate(s, i, gravity, (delta_time * (float)period) / (float)substeps);
+}
+
+struct p2d_integrate_job {
+    vec2_t gravity;
+    float delta_time;
+    float dt;
+    int substep;
+};
+
+// every body only touches its own columns, so ranges can run on any thread
+static void _p2d_bodies_integrate_range(void *data, int begin, int end, int thread) {
+    struct p2d_integrate_job *job = data;
+    struct p2d_body_store *s = &p2d_bodies;
+    (void)thread;
+
+    for(int i = begin; i < end; i++) {
+        if(s->flags[i] & P2D_BODY_FROZEN) {
+            continue;
+        }
+
+        if(s->lod[i] == 0) {
+            _p2d_body_integrate(s, i, job->gravity, job->dt);
+        }
+        else {
+            _p2d_body_integrate_lod(s, i, job->gravity, job->delta_time, job->substep);
+        }
+    }
+}
+
+void p2d_bodies_integrate(float delta_time, int substep) {
+    struct p2d_integrate_job job = {
+        .gravity = p2d_state.p2d_gravity,
+        .delta_time = delta_time,
+        .dt = delta_time / (float)p2d_state.p2d_substeps,
+        .substep = substep
+    };
+
+    p2d_parallel_for(p2d_bodies.count, P2D_JOB_GRAIN, _p2d_bodies_integrate_range, &job);
+}
+
+void p2d_body_output(struct p2d_object *object, float x, float y, float rotation) {
+    p2d_bodies.previous_transforms[object->handle] = p2d_bodies.transforms[object->handle];
+    p2d_bodies.transforms[object->handle] = (struct p2d_transform){x, y, rotation};
+
+    if(p2d_state.p2d_transform_output) {
+        return;
+    }
+
+    // delta updates (engine syncing)
+    if(object->out_x)
+        *object->out_x += x - object->x;
+    if(object->out_y)
+        *object->out_y += y - object->y;
+    if(object->out_rotation)
+        *object->out_rotation += rotation - object->rotation;
+}
+
+const struct p2d_transform *p2d_get_previous_transforms(int *count) {
+    if(count) {
+        *count = p2d_bodies.handle_count;
+    }
+    return p2d_bodies.previous_transforms;
+}
+
+struct p2d_transform p2d_get_interpolated_transform(int handle) {
+    if(handle < 0 || handle >= p2d_bodies.handle_count) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_get_interpolated_transform: %d is not a handle.\n", handle);
+        return (struct p2d_transform){0};
+    }
+
+    struct p2d_transform from = p2d_bodies.previous_transforms[handle];
+    struct p2d_transform to = p2d_bodies.transforms[handle];
+    float alpha = p2d_state.p2d_alpha;
+
+    return (struct p2d_transform){
+        from.x + (to.x - from.x) * alpha,
+        from.y + (to.y - from.y) * alpha,
+        from.rotation + (to.rotation - from.rotation) * alpha
+    };
+}
+
+const int *p2d_get_changed_bodies(int *count) {
+    if(count) {
+        *count = p2d_bodies.changed_count;
+    }
+    return p2d_bodies.changed;
+}
+
+const struct p2d_transform *p2d_get_transforms(int *count) {
+    if(count) {
+        *count = p2d_bodies.handle_count;
+    }
+    return p2d_bodies.transforms;
+}
+
+void p2d_bodies_scatter(void) {
+    struct p2d_body_store *s = &p2d_bodies;
+
+    // whatever moved last step and not this one has stopped where it was
+    for(int c = 0; c < s->changed_count; c++) {
+        int h = s->changed[c];
+        s->previous_transforms[h] = s->transforms[h];
+    }
+    s->changed_count = 0;
+
+    for(int i = 0; i < s->count; i++) {
+        if(!(s->flags[i] & P2D_BODY_TOUCHED)) {
+            continue;
+        }
+
+        struct p2d_object *object = p2d_objects[i];
+
+        // anything untouched can't have moved or changed its sleep state
+        int h = s->handle[i];
+        bool sleeping = (s->flags[i] & P2D_BODY_SLEEPING) != 0;
+        if(s->x[i] != object->x || s->y[i] != object->y || s->rotation[i] != object->rotation || sleeping != s->reported_sleeping[h]) {
+            s->changed[s->changed_count++] = h;
+            s->reported_sleeping[h] = sleeping;
+        }
+        p2d_body_output(object, s->x[i], s->y[i], s->rotation[i]);
+
+        object->x = s->x[i];
+        object->y = s->y[i];
+        object->rotation = s->rotation[i];
+        object->vx = s->vx[i];
+        object->vy = s->vy[i];
+        object->vr = s->vr[i];
+
+        s->flags[i] &= (uint8_t)~P2D_BODY_TOUCHED;
+    }
+}
+
+//
+// PROXIES
+//
+
+struct p2d_aabb p2d_body_update_aabb(int index) {
+    struct p2d_object proxy;
+    p2d_body_proxy(index, &proxy);
+
+    p2d_bodies.aabb[index] = p2d_get_aabb(&proxy);
+    return p2d_bodies.aabb[index];
+}
+
+void p2d_body_proxy(int index, struct p2d_object *out) {
+    struct p2d_body_store *s = &p2d_bodies;
+    int i = index;
+    uint8_t flags = s->flags[i];
+
+    memset(out, 0, sizeof(*out));
+
+    out->type = (enum p2d_object_type)s->type[i];
+    out->is_static = (flags & P2D_BODY_STATIC) != 0;
+    out->is_trigger = (flags & P2D_BODY_TRIGGER) != 0;
+
+    out->x = s->x[i];
+    out->y = s->y[i];
+    out->vx = s->vx[i];
+    out->vy = s->vy[i];
+    out->vr = s->vr[i];
+    out->rotation = s->rotation[i];
+
+    if(out->type == P2D_OBJECT_RECTANGLE) {
+        out->rectangle.width = s->width[i];
+        out->rectangle.height = s->height[i];
+    }
+    else {
+        out->circle.radius = s->width[i];
+    }
+
+    out->restitution = s->restitution[i];
+    out->static_friction = s->static_friction[i];
+    out->dynamic_friction = s->dynamic_friction[i];
+    out->inv_mass = s->inv_mass[i];
+    out->inv_inertia = s->inv_inertia[i];
+
+    out->sleeping = (flags & P2D_BODY_SLEEPING) != 0;
+    out->culled = (flags & P2D_BODY_CULLED) != 0;
+    out->parked = (flags & P2D_BODY_PARKED) != 0;
+    out->lod = s->lod[i];
+    out->mask = s->mask[i];
+
+    out->handle = s->handle[i];
+}
+
+void p2d_body_store_pose(int index, const struct p2d_object *proxy) {
+    p2d_bodies.x[index] = proxy->x;
+    p2d_bodies.y[index] = proxy->y;
+    p2d_bodies.rotation[index] = proxy->rotation;
+}
+
+void p2d_body_store_velocity(int index, const struct p2d_object *proxy) {
+    p2d_bodies.vx[index] = proxy->vx;
+    p2d_bodies.vy[index] = proxy->vy;
+    p2d_bodies.vr[index] = proxy->vr;
+}
@@ -0,0 +1,270 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <stdlib.h>
+
+#include "p2d/log.h"
+#include "p2d/core.h"
+#include "p2d/jobs.h"
+#include "p2d/joint.h"
+#include "p2d/context.h"
+
+struct p2d_state p2d_state = {0};
+
+static p2d_world_t default_world = {.state = &p2d_state};
+
+P2D_THREAD_LOCAL p2d_world_t *p2d_active_world = &default_world;
+
+p2d_world_t *p2d_get_world(void) {
+    return p2d_active_world;
+}
+
+p2d_world_t *p2d_default_world(void) {
+    return &default_world;
+}
+
+p2d_world_t *p2d_world_use(p2d_world_t *world) {
+    p2d_world_t *previous = p2d_active_world;
+    p2d_active_world = world ? world : &default_world;
+    return previous;
+}
+
+p2d_world_t *p2d_world_create(
+    int cell_size,
+    void (*on_collision)(struct p2d_cb_data *data),
+    void (*on_trigger)(struct p2d_cb_data *data),
+    void (*log_fn)(int level, const char *fmt, ...),
+    const struct p2d_capacity *capacity
+){
+    p2d_world_t *world = calloc(1, sizeof(p2d_world_t));
+    if(!world) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_world_create: failed to allocate memory.\n");
+        return NULL;
+    }
+    world->state = &world->own_state;
+
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_init_with_capacity(cell_size, on_collision, on_trigger, log_fn, capacity);
+    if(!ok) {
+        p2d_shutdown();
+    }
+    p2d_world_use(previous);
+
+    if(!ok) {
+        free(world);
+        return NULL;
+    }
+
+    return world;
+}
+
+void p2d_world_destroy(p2d_world_t *world) {
+    if(!world || world == &default_world) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_world_destroy: can only destroy worlds made by p2d_world_create.\n");
+        return;
+    }
+
+    p2d_world_t *previous = p2d_world_use(world);
+    p2d_shutdown();
+    p2d_world_use(previous == world ? NULL : previous);
+
+    free(world);
+}
+
+void p2d_world_step(p2d_world_t *world, float delta_time) {
+    p2d_world_t *previous = p2d_world_use(world);
+    p2d_step(delta_time);
+    p2d_world_use(previous);
+}
+
+bool p2d_world_create_object(p2d_world_t *world, struct p2d_object *object) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_create_object(object);
+    p2d_world_use(previous);
+    return ok;
+}
+
+bool p2d_world_remove_object(p2d_world_t *world, struct p2d_object *object) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_remove_object(object);
+    p2d_world_use(previous);
+    return ok;
+}
+
+bool p2d_world_create_objects(p2d_world_t *world, struct p2d_object *objects, int count) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_create_objects(objects, count);
+    p2d_world_use(previous);
+    return ok;
+}
+
+bool p2d_world_remove_objects(p2d_world_t *world, struct p2d_object *objects, int count) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_remove_objects(objects, count);
+    p2d_world_use(previous);
+    return ok;
+}
+
+bool p2d_world_remove_all_objects(p2d_world_t *world) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_remove_all_objects();
+    p2d_world_use(previous);
+    return ok;
+}
+
+bool p2d_world_add_joint(p2d_world_t *world, struct p2d_joint *joint) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_add_joint(joint);
+    p2d_world_use(previous);
+    return ok;
+}
+
+void p2d_world_remove_joint(p2d_world_t *world, struct p2d_joint *joint) {
+    p2d_world_t *previous = p2d_world_use(world);
+    p2d_remove_joint(joint);
+    p2d_world_use(previous);
+}
+
+int p2d_world_advance(p2d_world_t *world, float real_delta_time) {
+    p2d_world_t *previous = p2d_world_use(world);
+    int result = p2d_advance(real_delta_time);
+    p2d_world_use(previous);
+    return result;
+}
+
+int p2d_world_add_region(p2d_world_t *world, struct p2d_aabb bounds) {
+    p2d_world_t *previous = p2d_world_use(world);
+    int result = p2d_add_region(bounds);
+    p2d_world_use(previous);
+    return result;
+}
+
+bool p2d_world_move_region(p2d_world_t *world, int region, struct p2d_aabb bounds) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_move_region(region, bounds);
+    p2d_world_use(previous);
+    return ok;
+}
+
+bool p2d_world_remove_region(p2d_world_t *world, int region) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_remove_region(region);
+    p2d_world_use(previous);
+    return ok;
+}
+
+bool p2d_world_raycast(p2d_world_t *world, vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, struct p2d_raycast_hit *hit) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool found = p2d_raycast(origin, direction, max_distance, mask, hit);
+    p2d_world_use(previous);
+    return found;
+}
+
+int p2d_world_raycast_all(p2d_world_t *world, vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, p2d_raycast_fn callback, void *user_data) {
+    p2d_world_t *previous = p2d_world_use(world);
+    int result = p2d_raycast_all(origin, direction, max_distance, mask, callback, user_data);
+    p2d_world_use(previous);
+    return result;
+}
+
+int p2d_world_raycast_batch(p2d_world_t *world, const struct p2d_ray_query *rays, int count, struct p2d_raycast_hit *hits) {
+    p2d_world_t *previous = p2d_world_use(world);
+    int result = p2d_raycast_batch(rays, count, hits);
+    p2d_world_use(previous);
+    return result;
+}
+
+size_t p2d_world_snapshot_size(p2d_world_t *world) {
+    p2d_world_t *previous = p2d_world_use(world);
+    size_t result = p2d_snapshot_size();
+    p2d_world_use(previous);
+    return result;
+}
+
+size_t p2d_world_snapshot_save(p2d_world_t *world, void *buffer, size_t size) {
+    p2d_world_t *previous = p2d_world_use(world);
+    size_t result = p2d_snapshot_save(buffer, size);
+    p2d_world_use(previous);
+    return result;
+}
+
+bool p2d_world_snapshot_restore(p2d_world_t *world, const void *buffer, size_t size) {
+    p2d_world_t *previous = p2d_world_use(world);
+    bool ok = p2d_snapshot_restore(buffer, size);
+    p2d_world_use(previous);
+    return ok;
+}
+
+const struct p2d_transform * p2d_world_get_transforms(p2d_world_t *world, int *count) {
+    p2d_world_t *previous = p2d_world_use(world);
+    const struct p2d_transform *result = p2d_get_transforms(count);
+    p2d_world_use(previous);
+    return result;
+}
+
+struct p2d_transform p2d_world_get_interpolated_transform(p2d_world_t *world, int handle) {
+    p2d_world_t *previous = p2d_world_use(world);
+    struct p2d_transform result = p2d_get_interpolated_transform(handle);
+    p2d_world_use(previous);
+    return result;
+}
+
+const struct p2d_event * p2d_world_get_events(p2d_world_t *world, int *count) {
+    p2d_world_t *previous = p2d_world_use(world);
+    const struct p2d_event *result = p2d_get_events(count);
+    p2d_world_use(previous);
+    return result;
+}
+
+uint64_t p2d_world_state_hash(p2d_world_t *world) {
+    p2d_world_t *previous = p2d_world_use(world);
+    uint64_t result = p2d_state_hash();
+    p2d_world_use(previous);
+    return result;
+}
+
+struct p2d_world_batch {
+    p2d_world_t **worlds;
+    float delta_time;
+    int steps;
+};
+
+static void _p2d_step_world_range(void *data, int begin, int end, int thread) {
+    struct p2d_world_batch *batch = data;
+    (void)thread;
+
+    p2d_world_t *previous = p2d_active_world;
+    for(int w = begin; w < end; w++) {
+        p2d_active_world = batch->worlds[w];
+        for(int s = 0; s < batch->steps; s++) {
+            p2d_step(batch->delta_time);
+        }
+    }
+    p2d_active_world = previous;
+}
+
+void p2d_step_worlds(p2d_world_t **worlds, int count, float delta_time, int steps) {
+    if(!worlds || count <= 0 || steps <= 0) {
+        return;
+    }
+
+    for(int w = 0; w < count; w++) {
+        if(!worlds[w]) {
+            p2d_logf(P2D_LOG_ERROR, "p2d_step_worlds: world %d is NULL.\n", w);
+            return;
+        }
+    }
+
+    struct p2d_world_batch batch = {
+        .worlds = worlds,
+        .delta_time = delta_time,
+        .steps = steps
+    };
+
+    // whole worlds are the unit of work (and of stealing)
+    p2d_parallel_for(count, 1, _p2d_step_world_range, &batch);
+}
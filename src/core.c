@@ -5,24 +5,40 @@
     Licensed under the MIT license. See LICENSE file in the project root for details.
 */
 
+#include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "p2d/log.h"
+#include "p2d/body.h"
 #include "p2d/core.h"
+#include "p2d/context.h"
 #include "p2d/world.h"
 #include "p2d/types.h"
 #include "p2d/joint.h"
 #include "p2d/pairs.h"
+#include "p2d/island.h"
+#include "p2d/region.h"
 #include "p2d/collide.h"
 #include "p2d/helpers.h"
 #include "p2d/contacts.h"
 #include "p2d/detection.h"
 #include "p2d/resolution.h"
-
-struct p2d_state p2d_state = {0};
+#include "p2d/narrowphase.h"
+#include "p2d/solver.h"
+#include "p2d/statehash.h"
+#include "p2d/events.h"
+#include "p2d/triggers.h"
+#include "p2d/query.h"
+#include "internal.h"
+
+// contracted or reassociated math would differ from other builds of the same scene
+#if defined(P2D_DETERMINISTIC) && defined(__FAST_MATH__)
+    #error "P2D_DETERMINISTIC builds can't use -ffast-math"
+#endif
 
 //
 // INIT
@@ -35,6 +51,16 @@ bool p2d_init(
     void (*on_collision)(struct p2d_cb_data *data),
     void (*on_trigger)(struct p2d_cb_data *data),
     void (*log_fn)(int level, const char *fmt, ...)
+){
+    return p2d_init_with_capacity(cell_size, on_collision, on_trigger, log_fn, NULL);
+}
+
+bool p2d_init_with_capacity(
+    int cell_size,
+    void (*on_collision)(struct p2d_cb_data *data),
+    void (*on_trigger)(struct p2d_cb_data *data),
+    void (*log_fn)(int level, const char *fmt, ...),
+    const struct p2d_capacity *capacity
 ){
     // initialize external logger (if provided)
     p2d_state.log = log_fn;
@@ -48,7 +74,24 @@ bool p2d_init(
     p2d_state.p2d_substeps = P2D_DEFAULT_SUBSTEPS;
     p2d_state.p2d_joint_iterations = P2D_DEFAULT_JOINT_SUBSTEPS;
 
-    p2d_state.p2d_frustum_sleeping = false;
+    p2d_state.p2d_region_sleeping = false;
+    p2d_state.p2d_lod_tiers = 0;
+    p2d_state.p2d_lod_rate = P2D_DEFAULT_LOD_RATE;
+    p2d_state.p2d_lod_distance = P2D_DEFAULT_LOD_DISTANCE;
+    p2d_state.p2d_step_count = 0;
+
+    p2d_state.p2d_rest_sleeping = true;
+    p2d_state.p2d_sleep_linear_threshold = P2D_DEFAULT_SLEEP_LINEAR_THRESHOLD;
+    p2d_state.p2d_sleep_angular_threshold = P2D_DEFAULT_SLEEP_ANGULAR_THRESHOLD;
+    p2d_state.p2d_sleep_time = P2D_DEFAULT_SLEEP_TIME;
+
+    p2d_state.p2d_deterministic = P2D_DEFAULT_DETERMINISTIC;
+    p2d_state.p2d_trigger_layers = 0xFFFF;
+
+    p2d_state.p2d_fixed_delta_time = P2D_DEFAULT_FIXED_DELTA_TIME;
+    p2d_state.p2d_max_advance_steps = P2D_DEFAULT_MAX_ADVANCE_STEPS;
+    p2d_state.p2d_accumulator = 0.0f;
+    p2d_state.p2d_alpha = 0.0f;
 
     p2d_state.p2d_mass_scaling = P2D_DEFAULT_MASS_SCALE;
     p2d_state.p2d_air_density = P2D_DEFAULT_AIR_DENSITY;
@@ -66,6 +109,27 @@ bool p2d_init(
     p2d_state.p2d_object_count = 0;
     p2d_state.p2d_world_node_count = 0;
 
+    int objects = P2D_DEFAULT_OBJECT_CAPACITY;
+    int joints = P2D_DEFAULT_JOINT_CAPACITY;
+    p2d_state.p2d_memory_budget = 0;
+    if(capacity) {
+        if(capacity->objects < 0 || capacity->joints < 0) {
+            p2d_logf(P2D_LOG_ERROR, "p2d_init: capacities must not be negative.\n");
+            return false;
+        }
+        if(capacity->objects > 0)
+            objects = capacity->objects;
+        if(capacity->joints > 0)
+            joints = capacity->joints;
+        p2d_state.p2d_memory_budget = capacity->memory_budget;
+    }
+
+    // the broad phase keeps about one bucket per object
+    if(!p2d_bodies_reserve(objects) || !p2d_joints_reserve(joints) || !p2d_world_reserve(objects)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_init: initial capacity does not fit in the memory budget.\n");
+        return false;
+    }
+
     p2d_pairs_init();
 
     p2d_logf(P2D_LOG_INFO, "p2d initialized with cell size: %d.\n", cell_size);
@@ -111,12 +175,16 @@ void p2d_for_each_intersecting_tile(struct p2d_object *object, void (*callback)(
         return;
     }
 
-    struct p2d_aabb aabb = p2d_get_aabb(object);
-    
-    int start_tile_x = (int)(aabb.x / p2d_state.p2d_cell_size);
-    int start_tile_y = (int)(aabb.y / p2d_state.p2d_cell_size);
-    int end_tile_x = (int)((aabb.x + aabb.w) / p2d_state.p2d_cell_size);
-    int end_tile_y = (int)((aabb.y + aabb.h) / p2d_state.p2d_cell_size);
+    p2d_for_each_tile_in_aabb(object, p2d_get_aabb(object), callback);
+}
+
+void p2d_for_each_tile_in_aabb(struct p2d_object *object, struct p2d_aabb aabb, void (*callback)(struct p2d_object *object, int tile_hash)) {
+    // floored, tile t covers [t * cell size, (t + 1) * cell size) on either side of 0
+    float cell = (float)p2d_state.p2d_cell_size;
+    int start_tile_x = (int)floorf(aabb.x / cell);
+    int start_tile_y = (int)floorf(aabb.y / cell);
+    int end_tile_x = (int)floorf((aabb.x + aabb.w) / cell);
+    int end_tile_y = (int)floorf((aabb.y + aabb.h) / cell);
 
     for (int tile_x = start_tile_x; tile_x <= end_tile_x; tile_x++) {
         for (int tile_y = start_tile_y; tile_y <= end_tile_y; tile_y++) {
@@ -149,31 +217,11 @@ void _unregister_intersecting_tiles(struct p2d_object *object, int hash) {
 // OBJECT MANAGEMENT
 //
 
-bool p2d_create_object(struct p2d_object *object) {
-    if(!object) {
-        p2d_logf(P2D_LOG_ERROR, "p2d_create_object: object is NULL.\n");
-        return false;
-    }
-
-    // Detect all world tiles the object intersects with, and add it to each
-    // p2d_for_each_intersecting_tile(object, _register_intersecting_tiles);
-    // ^^^ NO! this happens implicitely each frame
-
-    // insert into track array
-    for(int i = 0; i < P2D_MAX_OBJECTS; i++) {
-        if(p2d_objects[i] == NULL) {
-            p2d_objects[i] = object;
-            break;
-        }
-    }
-
+// mass_scaling is passed in so batches read it once
+static void _p2d_compute_mass(struct p2d_object *object, float mass_scaling) {
     object->mass = 0.0f;
     object->inertia = 0.0f;
 
-    if(object->density < P2D_MIN_DENSITY || object->density > P2D_MAX_DENSITY) {
-        p2d_logf(P2D_LOG_WARN, "p2d_create_object: object density is out of range.\n");
-    }
-
     /*
         UNUSED (for now?)
     */
@@ -195,8 +243,6 @@ bool p2d_create_object(struct p2d_object *object) {
             break;
     }
 
-    float mass_scaling = p2d_state.p2d_mass_scaling; // TODO: this breaks when changing mid sim- kinda on the user atp
-
     if(!object->is_static) {
         // compute mass and inertia from density and size
         if(object->type == P2D_OBJECT_RECTANGLE) {
@@ -213,11 +259,70 @@ bool p2d_create_object(struct p2d_object *object) {
 
     object->inv_mass = (object->mass > 0.0f) ? 1.0f / object->mass : 0.0f;
     object->inv_inertia = (object->inertia > 0.0f) ? 1.0f / object->inertia : 0.0f;
+}
+
+void p2d_object_compute_mass(struct p2d_object *object) {
+    _p2d_compute_mass(object, p2d_state.p2d_mass_scaling); // TODO: this breaks when changing mid sim- kinda on the user atp
+}
+
+bool p2d_create_object(struct p2d_object *object) {
+    if(!object) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_create_object: object is NULL.\n");
+        return false;
+    }
+
+    // Detect all world tiles the object intersects with, and add it to each
+    // p2d_for_each_intersecting_tile(object, _register_intersecting_tiles);
+    // ^^^ NO! this happens implicitely each frame
+
+
+    if(object->density < P2D_MIN_DENSITY || object->density > P2D_MAX_DENSITY) {
+        p2d_logf(P2D_LOG_WARN, "p2d_create_object: object density is out of range.\n");
+    }
+
+    p2d_object_compute_mass(object);
+
+    // insert into the packed body store / track array
+    object->handle = p2d_body_attach(object);
+    if(object->handle == -1) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_create_object: could not grow past %d objects.\n", p2d_state.p2d_object_count);
+        return false;
+    }
 
     p2d_state.p2d_object_count++;
     return true;
 }
 
+bool p2d_create_objects(struct p2d_object *objects, int count) {
+    if(!objects || count < 0) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_create_objects: objects is NULL or count is negative.\n");
+        return false;
+    }
+
+    // one pass for the checks, one warning for the whole batch
+    int out_of_range = 0;
+    for(int i = 0; i < count; i++) {
+        out_of_range += objects[i].density < P2D_MIN_DENSITY || objects[i].density > P2D_MAX_DENSITY;
+    }
+    if(out_of_range) {
+        p2d_logf(P2D_LOG_WARN, "p2d_create_objects: %d object densities are out of range.\n", out_of_range);
+    }
+
+    float mass_scaling = p2d_state.p2d_mass_scaling;
+    for(int i = 0; i < count; i++) {
+        _p2d_compute_mass(&objects[i], mass_scaling);
+    }
+
+    // one growth for the whole batch, statics go in the static table with a single rebuild
+    if(!p2d_body_attach_many(objects, count)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_create_objects: could not grow past %d objects.\n", p2d_state.p2d_object_count);
+        return false;
+    }
+
+    p2d_state.p2d_object_count += count;
+    return true;
+}
+
 bool p2d_remove_object(struct p2d_object *object) {
     if(!object) {
         p2d_logf(P2D_LOG_ERROR, "p2d_remove_object: object is NULL.\n");
@@ -228,27 +333,90 @@ bool p2d_remove_object(struct p2d_object *object) {
     // p2d_for_each_intersecting_tile(object, _unregister_intersecting_tiles);
     // ^^^ NO! this happens implicitely each frame
 
-    // remove from track array
-    for(int i = 0; i < P2D_MAX_OBJECTS; i++) {
-        if(p2d_objects[i] == object) {
-            p2d_objects[i] = NULL;
-            break;
-        }
+    int index = p2d_body_index(object->handle);
+    if(index < 0 || p2d_objects[index] != object) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_remove_object: object is not registered.\n");
+        return false;
     }
 
+    // whatever was resting on (or against) this object needs to react to it leaving
+    p2d_unpark_object(object);
+    p2d_release_culled_object(object);
+    p2d_wake_object(object);
+
+    // swap remove from the packed body store / track array
+    p2d_body_detach(object->handle);
+    object->handle = -1;
+
     p2d_state.p2d_object_count--;
     return true;
 }
 
+bool p2d_remove_objects(struct p2d_object *objects, int count) {
+    if(!objects || count < 0) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_remove_objects: objects is NULL or count is negative.\n");
+        return false;
+    }
+
+    int removed = 0;
+    for(int i = 0; i < count; i++) {
+        struct p2d_object *object = &objects[i];
+
+        int index = p2d_body_index(object->handle);
+        if(index < 0 || p2d_objects[index] != object) {
+            continue;
+        }
+
+        // waking the first of a sleeping pile wakes the rest, after that these are cheap
+        p2d_unpark_object(object);
+        p2d_release_culled_object(object);
+        p2d_wake_object(object);
+
+        p2d_body_detach(object->handle);
+        object->handle = -1;
+        removed++;
+    }
+
+    p2d_state.p2d_object_count -= removed;
+
+    if(removed != count) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_remove_objects: %d of the objects were not registered.\n", count - removed);
+        return false;
+    }
+    return true;
+}
+
 bool p2d_remove_all_objects(void) {
     p2d_world_remove_all();
+    p2d_world_remove_all_resting();
+    p2d_world_remove_all_statics();
+    p2d_release_all_culled_objects();
+    p2d_bodies_clear();
+    p2d_state.p2d_object_count = 0;
     return true;
 }
 
 bool p2d_shutdown(void) {
     p2d_remove_all_objects();
+    p2d_remove_all_regions();
     p2d_reset_collision_pairs();
+    p2d_remove_all_joints();
+    p2d_culled_shutdown();
+    p2d_narrowphase_shutdown();
+    p2d_solver_shutdown();
+    p2d_state_hash_shutdown();
+    p2d_events_shutdown();
+    p2d_triggers_shutdown();
+    p2d_query_shutdown();
+    p2d_world_shutdown();
+    p2d_joints_shutdown();
+    p2d_bodies_shutdown();
     p2d_logf(P2D_LOG_INFO, "p2d shutdown.\n");
+
+    // nothing carries over into the next p2d_init() on this world, except where its state lives (the first field)
+    p2d_world_t *world = P2D_ACTIVE_WORLD;
+    memset(world->state, 0, sizeof(*world->state));
+    memset(&world->own_state, 0, sizeof(*world) - offsetof(p2d_world_t, own_state));
     return true;
 }
 
@@ -268,9 +436,10 @@ struct p2d_collision_manifold p2d_generate_manifold(struct p2d_object *a, struct
     manifold.normal = normal;
     manifold.penetration = penetration;
 
-    manifold.contact_points[0] = contacts->contacts[0].contact_point;
-    manifold.contact_points[1] = contacts->contacts[1].contact_point;
     manifold.contact_count = (int)contacts->count;
+    for(int i = 0; i < manifold.contact_count && i < 2; i++) {
+        manifold.contact_points[i] = contacts->contacts[i].contact_point;
+    }
 
     return manifold;
 }
@@ -278,7 +447,7 @@ struct p2d_collision_manifold p2d_generate_manifold(struct p2d_object *a, struct
 void p2d_separate_bodies(struct p2d_object *a, struct p2d_object *b, vec2_t normal, float depth) {
     vec2_t mtv = {.x = normal.x * depth, .y = normal.y * depth};
 
-    if(a->is_static) {
+    if(a->is_static || a->parked) {
         b->x += mtv.x;
         b->y += mtv.y;
 
@@ -288,7 +457,7 @@ void p2d_separate_bodies(struct p2d_object *a, struct p2d_object *b, vec2_t norm
         if(b->out_y)
             *b->out_y += mtv.y;
     }
-    else if(b->is_static) {
+    else if(b->is_static || b->parked) {
         a->x += -mtv.x;
         a->y += -mtv.y;
 
@@ -335,12 +504,8 @@ bool p2d_should_collide(struct p2d_object *a, struct p2d_object *b) {
         
         TODO: early out by counting joints seen vs registered
     */
-    for(int i = 0; i < P2D_MAX_JOINTS; i++) {
+    for(int i = 0; i < p2d_state.p2d_joint_count; i++) {
         struct p2d_joint *joint = p2d_joints[i];
-        if(joint == NULL) {
-            continue;
-        }
-
         if(joint->anchored_to_world) {
             continue;
         }
@@ -371,22 +536,23 @@ void p2d_step(float delta_time) {
     if(p2d_state.out_contacts) {
         p2d_contact_list_clear(p2d_state.out_contacts);
     }
+    p2d_events_clear();
+
+    // region membership is only decided between steps, objects don't leave them mid step
+    p2d_update_regions();
+
+    // from here on the step only reads and writes the body store
+    p2d_bodies_gather();
+
+    p2d_islands_begin();
 
     // substepping
     for(int it_track = 0; it_track < p2d_state.p2d_substeps; it_track++) {
 
     /*
-        Step each object in the world
+        Step each body in the world
     */
-    for(int i = 0; i < P2D_MAX_OBJECTS; i++) {
-        struct p2d_object *object = p2d_objects[i];
-        if(object == NULL) {
-            continue;
-        }
-
-        if(!object->sleeping)
-            p2d_object_step(object, delta_time, p2d_state.p2d_substeps);
-    }
+    p2d_bodies_integrate(delta_time, it_track);
 
     /*
         Reset and re-register world state for broad phase collision detection
@@ -397,116 +563,76 @@ void p2d_step(float delta_time) {
     p2d_reset_collision_pairs();
 
     /*
-        For each bucket containing objects, generate contacts
-        with all other objects in the bucket (excluding self)
+        Find the candidate pairs, run the narrow phase over them (on the job system),
+        then separate and resolve whatever touches, a color of the contact graph at a time
     */
     p2d_state.p2d_contact_checks = 0;
     p2d_state.p2d_contacts_found = 0;
-    for(int i = 0; i < P2D_MAX_OBJECTS; i++) {
-        struct p2d_world_node *head_node = p2d_world[i];
-        if(head_node == NULL) {
-            continue;
-        }
-
-        struct p2d_world_node *node_a = head_node;
-
-        while(node_a) {
-            struct p2d_world_node *node_b = node_a->next;
-
-            while(node_b) {
-                p2d_state.p2d_contact_checks++;
-                if(node_a != node_b) {
-                    struct p2d_object *a = node_a->object;
-                    struct p2d_object *b = node_b->object;
-
-                    /*
-                        last check - might be expensive (profile)
-                        we want to see if they are even eligible to collide,
-                        taking a collision mask and some other meta like if they revolute each other into account
-                    */
-                    if(!p2d_should_collide(a, b)) {
-                        node_b = node_b->next;
-                        continue;
-                    }
-
-                    // if already collided, skip (multi grid node collision)
-                    if(p2d_collision_pair_exists(a, b)) {
-                        node_b = node_b->next;
-                        continue;
-                    }
-
-                    struct p2d_collision_info d = {0};
-                    if(p2d_collide(a, b, &d)) {
-                        p2d_add_collision_pair(a, b);
-
-                        /*
-                            If one is a trigger, no need to seperate or solve
-
-                            TODO: could also include normal and depth, or collider collidee info
-                        */
-                        if(a->is_trigger || b->is_trigger) {
-                            if(p2d_state.on_trigger) {
-                                struct p2d_cb_data data = {
-                                    .a = a,
-                                    .b = b
-                                };
-                                p2d_state.on_trigger(&data);
-                                break;
-                            }
-                        }
-
-                        // get all contacts
-                        struct p2d_contact_list *contacts = p2d_generate_contacts(a, b);
-
-                        // seperate after contacts - i think 2bit had some weird deferred movement
-                        p2d_separate_bodies(a, b, d.normal, d.depth);
-
-                        // early out
-                        if(!contacts || contacts->count <= 0) {
-                            node_b = node_b->next;
-                            continue;
-                        }
-                        p2d_state.p2d_contacts_found += (int)contacts->count;
-
-                        // debug: add all contacts to the global list
-                        if(p2d_state.out_contacts) {
-                            for(size_t z = 0; z < contacts->count; z++) {
-                                p2d_contact_list_add(p2d_state.out_contacts, contacts->contacts[z]);
-                            }
-                        }
-
-                        // create contact manifold for resolution
-                        struct p2d_collision_manifold manifold =
-                            p2d_generate_manifold(a, b, d.normal, d.depth, contacts);
-
-                        // now, resolve their collision
-                        p2d_resolve_collision(&manifold);
-
-                        // cleanup
-                        p2d_contact_list_destroy(contacts);
-
-                        // inform the subscriber of the collision
-                        if(p2d_state.on_collision) {
-                            struct p2d_cb_data data = {
-                                .a = a,
-                                .b = b
-                            };
-                            p2d_state.on_collision(&data);
-                        }
-                    }
-                }
-
-                node_b = node_b->next;
-            }
+    bool sensing = it_track == p2d_state.p2d_substeps - 1;
+    p2d_collect_candidates(sensing);
+    p2d_run_narrowphase();
 
-            node_a = node_a->next;
-        }
+    // triggers only need to know what they overlap, once a step
+    if(sensing) {
+        p2d_triggers_detect();
     }
 
+    p2d_solve_contacts();
+
     } // substepping
 
     // resolve joints
     for(int i = 0; i < p2d_state.p2d_joint_iterations; i++)
         p2d_resolve_joints(delta_time, p2d_state.p2d_substeps);
 
+    // rest timers, and sleep any island that has settled
+    p2d_islands_update(delta_time);
+
+    // the grid went in before the last solve and the joints moved bodies, queries until the next step need where they ended up
+    p2d_rebuild_world();
+
+    // before scatter, which clears the touched flags it goes by
+    if(p2d_state.p2d_state_hashing) {
+        p2d_state_hash_update();
+    }
+    else {
+        p2d_state_hash_invalidate();
+    }
+
+    // enters and exits, also before scatter, which clears the touched flags that hold sleeping overlaps
+    p2d_triggers_update();
+
+    // hand the results back to the user's objects
+    p2d_bodies_scatter();
+
+    p2d_state.p2d_step_count++;
+
+    // the step is over, callbacks are free to add and remove objects
+    p2d_events_dispatch();
+}
+
+int p2d_advance(float real_delta_time) {
+    float fixed = p2d_state.p2d_fixed_delta_time;
+    if(real_delta_time < 0.0f || fixed <= 0.0f) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_advance: real_delta_time must not be negative, and p2d_fixed_delta_time must be greater than 0.\n");
+        return 0;
+    }
+
+    p2d_state.p2d_accumulator += real_delta_time;
+
+    int steps = 0;
+    while(p2d_state.p2d_accumulator >= fixed && steps < p2d_state.p2d_max_advance_steps) {
+        p2d_step(fixed);
+        p2d_state.p2d_accumulator -= fixed;
+        steps++;
+    }
+
+    // too far behind (a hitch, or a breakpoint), catching up would only make the next frame slower
+    if(p2d_state.p2d_accumulator >= fixed) {
+        p2d_logf(P2D_LOG_WARN, "p2d_advance: dropping %.3f seconds.\n", p2d_state.p2d_accumulator - fmodf(p2d_state.p2d_accumulator, fixed));
+        p2d_state.p2d_accumulator = fmodf(p2d_state.p2d_accumulator, fixed);
+    }
+
+    p2d_state.p2d_alpha = p2d_state.p2d_accumulator / fixed;
+    return steps;
 }
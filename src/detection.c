@@ -8,6 +8,7 @@
 #include <float.h>
 
 #include "p2d/types.h"
+#include "p2d/helpers.h"
 #include "p2d/detection.h"
 
 bool p2d_obb_verts_intersects_obb_verts(struct p2d_obb_verts rect1, struct p2d_obb_verts rect2) {
@@ -72,3 +73,39 @@ bool p2d_circle_intersects_aabb(struct p2d_circle circle, struct p2d_aabb aabb)
 
     return distance < circle.radius;
 }
+
+// closest point of the rectangle to the circle's center, in the rectangle's own axes
+static bool _p2d_rect_intersects_circle(struct p2d_object *rect, struct p2d_object *circle) {
+    struct p2d_obb_verts verts = p2d_obb_to_verts(p2d_get_obb(rect));
+    float w = rect->rectangle.width;
+    float h = rect->rectangle.height;
+    if(w <= 0.0f || h <= 0.0f) {
+        return false;
+    }
+
+    vec2_t u = {{(verts.verts[1].x - verts.verts[0].x) / w, (verts.verts[1].y - verts.verts[0].y) / w}};
+    vec2_t v = {{(verts.verts[3].x - verts.verts[0].x) / h, (verts.verts[3].y - verts.verts[0].y) / h}};
+    vec2_t d = {{circle->x - verts.verts[0].x, circle->y - verts.verts[0].y}};
+
+    float s = p2d_clampf(d.x * u.x + d.y * u.y, 0.0f, w);
+    float t = p2d_clampf(d.x * v.x + d.y * v.y, 0.0f, h);
+
+    float dx = d.x - (u.x * s + v.x * t);
+    float dy = d.y - (u.y * s + v.y * t);
+    return dx * dx + dy * dy < circle->circle.radius * circle->circle.radius;
+}
+
+bool p2d_objects_intersect(struct p2d_object *a, struct p2d_object *b) {
+    if(a->type == P2D_OBJECT_CIRCLE && b->type == P2D_OBJECT_CIRCLE) {
+        float dx = b->x - a->x;
+        float dy = b->y - a->y;
+        float reach = a->circle.radius + b->circle.radius;
+        return dx * dx + dy * dy < reach * reach;
+    }
+
+    if(a->type == P2D_OBJECT_RECTANGLE && b->type == P2D_OBJECT_RECTANGLE) {
+        return p2d_obb_intersects_obb(p2d_get_obb(a), p2d_get_obb(b));
+    }
+
+    return a->type == P2D_OBJECT_RECTANGLE ? _p2d_rect_intersects_circle(a, b) : _p2d_rect_intersects_circle(b, a);
+}
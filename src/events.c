@@ -0,0 +1,177 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/context.h"
+#include "p2d/events.h"
+#include "p2d/memory.h"
+#include "p2d/narrowphase.h"
+#include "internal.h"
+
+static uint64_t _p2d_event_key(int a, int b) {
+    return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+}
+
+static int _p2d_event_slot(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    return (int)(key & (uint64_t)(p2d_events.slot_capacity - 1));
+}
+
+static void _p2d_event_insert(uint64_t key, int index) {
+    int slot = _p2d_event_slot(key);
+    while(p2d_events.slots[slot].index != 0) {
+        slot = (slot + 1) & (p2d_events.slot_capacity - 1);
+    }
+    p2d_events.slots[slot] = (struct p2d_event_slot){key, index + 1};
+}
+
+// keeps the table at most half full, rehashing this step's events when it grows
+static bool _p2d_events_reserve(int count) {
+    struct p2d_event_store *store = &p2d_events;
+
+    if(!p2d_grow((void **)&store->events, &store->capacity, count, sizeof(*store->events))) {
+        return false;
+    }
+
+    if(count * 2 > store->slot_capacity) {
+        if(!p2d_grow((void **)&store->slots, &store->slot_capacity, count * 2, sizeof(*store->slots))) {
+            return false;
+        }
+
+        memset(store->slots, 0, (size_t)store->slot_capacity * sizeof(*store->slots));
+        for(int i = 0; i < store->count; i++) {
+            _p2d_event_insert(_p2d_event_key(store->events[i].handle_a, store->events[i].handle_b), i);
+        }
+    }
+
+    return true;
+}
+
+const struct p2d_event *p2d_get_events(int *count) {
+    if(count) {
+        *count = p2d_events.count;
+    }
+    return p2d_events.events;
+}
+
+void p2d_events_clear(void) {
+    struct p2d_event_store *store = &p2d_events;
+
+    // only the slots this step used, newest first so every probe chain is still whole when walked
+    for(int i = store->count - 1; i >= 0; i--) {
+        uint64_t key = _p2d_event_key(store->events[i].handle_a, store->events[i].handle_b);
+        int slot = _p2d_event_slot(key);
+        while(store->slots[slot].index != 0 && store->slots[slot].key != key) {
+            slot = (slot + 1) & (store->slot_capacity - 1);
+        }
+        store->slots[slot].index = 0;
+    }
+    store->count = 0;
+}
+
+void p2d_events_record(enum p2d_event_type type, int handle_a, int handle_b, const struct p2d_narrow_manifold *manifold, float impulse) {
+    struct p2d_event_store *store = &p2d_events;
+
+    // the same pair can come up either way around
+    vec2_t normal = manifold ? manifold->info.normal : (vec2_t){{0, 0}};
+    if(handle_a > handle_b) {
+        int swap = handle_a;
+        handle_a = handle_b;
+        handle_b = swap;
+        normal = (vec2_t){{-normal.x, -normal.y}};
+    }
+
+    uint64_t key = _p2d_event_key(handle_a, handle_b);
+    struct p2d_event *event = NULL;
+    if(store->slot_capacity > 0) {
+        int slot = _p2d_event_slot(key);
+        while(store->slots[slot].index != 0) {
+            if(store->slots[slot].key == key) {
+                event = &store->events[store->slots[slot].index - 1];
+                break;
+            }
+            slot = (slot + 1) & (store->slot_capacity - 1);
+        }
+    }
+
+    if(event) {
+        event->impulse += impulse;
+        if(!manifold || manifold->info.depth <= event->depth) {
+            return;
+        }
+    }
+    else {
+        int ia = p2d_body_index(handle_a);
+        int ib = p2d_body_index(handle_b);
+        if(ia < 0 || ib < 0) {
+            return;
+        }
+
+        if(!_p2d_events_reserve(store->count + 1)) {
+            p2d_logf(P2D_LOG_ERROR, "p2d_events_record: out of memory, dropping events.\n");
+            return;
+        }
+
+        event = &store->events[store->count];
+        *event = (struct p2d_event){
+            .type = type,
+            .a = p2d_objects[ia],
+            .b = p2d_objects[ib],
+            .handle_a = handle_a,
+            .handle_b = handle_b,
+            .impulse = impulse
+        };
+        _p2d_event_insert(key, store->count++);
+    }
+
+    if(!manifold) {
+        return;
+    }
+
+    // the deepest substep describes the contact
+    event->normal = normal;
+    event->depth = manifold->info.depth;
+    event->contact_count = manifold->contact_count;
+    for(int c = 0; c < manifold->contact_count; c++) {
+        event->contact_points[c] = manifold->contacts[c].contact_point;
+    }
+}
+
+void p2d_events_dispatch(void) {
+    // callbacks may create and remove objects, which doesn't touch the buffer
+    for(int i = 0; i < p2d_events.count; i++) {
+        const struct p2d_event *event = &p2d_events.events[i];
+        if(event->type == P2D_EVENT_TRIGGER_STAY) {
+            continue;
+        }
+
+        void (*callback)(struct p2d_cb_data *data) = event->type == P2D_EVENT_COLLISION ? p2d_state.on_collision : p2d_state.on_trigger;
+        if(!callback) {
+            continue;
+        }
+
+        struct p2d_cb_data data = {
+            .a = event->a,
+            .b = event->b,
+            .event = event
+        };
+        callback(&data);
+    }
+}
+
+void p2d_events_shutdown(void) {
+    p2d_free(p2d_events.events, (size_t)p2d_events.capacity * sizeof(*p2d_events.events));
+    p2d_free(p2d_events.slots, (size_t)p2d_events.slot_capacity * sizeof(*p2d_events.slots));
+    memset(&p2d_events, 0, sizeof(p2d_events));
+}
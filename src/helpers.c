@@ -82,6 +82,27 @@ struct p2d_obb p2d_get_obb(struct p2d_object *object) {
     }
 }
 
+struct p2d_aabb p2d_get_loose_aabb(struct p2d_object *object) {
+    if(object->type == P2D_OBJECT_RECTANGLE) {
+        float extent = (object->rectangle.width + object->rectangle.height) * 0.5f;
+        float cx = object->x + object->rectangle.width * 0.5f;
+        float cy = object->y + object->rectangle.height * 0.5f;
+        return (struct p2d_aabb){
+            .x = cx - extent,
+            .y = cy - extent,
+            .w = extent * 2,
+            .h = extent * 2
+        };
+    }
+
+    return (struct p2d_aabb){
+        .x = object->x - object->circle.radius,
+        .y = object->y - object->circle.radius,
+        .w = object->circle.radius * 2,
+        .h = object->circle.radius * 2
+    };
+}
+
 void p2d_closest_point_on_segment_to_point(vec2_t sega, vec2_t segb, vec2_t point, vec2_t *outPoint, float *outDist) {
     vec2_t ab = {{segb.x - sega.x, segb.y - sega.y}};
     vec2_t ap = {{point.x - sega.x, point.y - sega.y}};
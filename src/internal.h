@@ -0,0 +1,40 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Short names for the active world's state, for the library's own sources only.
+
+    They are plain object like macros, so they are kept out of the public headers: there p2d_state
+    is a real variable (the default world's), and names like p2d_events would be taken from every
+    file that includes p2d.h.
+*/
+
+#ifndef P2D_INTERNAL_H
+#define P2D_INTERNAL_H
+
+#ifndef P2D_BUILDING
+    #error "internal.h is only for building p2d itself"
+#endif
+
+#include "p2d/context.h"
+
+// settings and counters, the default world's are the p2d_state variable itself
+#define p2d_state               (*P2D_ACTIVE_WORLD->state)
+
+// per module state
+#define p2d_broadphase          (P2D_ACTIVE_WORLD->broadphase)
+#define p2d_islands             (P2D_ACTIVE_WORLD->islands)
+#define p2d_regions             (P2D_ACTIVE_WORLD->regions)
+#define p2d_pairs               (P2D_ACTIVE_WORLD->pairs)
+#define p2d_narrowphase         (P2D_ACTIVE_WORLD->narrowphase)
+#define p2d_solver              (P2D_ACTIVE_WORLD->solver)
+#define p2d_state_hashes        (P2D_ACTIVE_WORLD->state_hash)
+#define p2d_events              (P2D_ACTIVE_WORLD->events)
+#define p2d_triggers            (P2D_ACTIVE_WORLD->triggers)
+#define p2d_queries             (P2D_ACTIVE_WORLD->queries)
+
+#endif // P2D_INTERNAL_H
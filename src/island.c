@@ -0,0 +1,246 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <math.h>
+#include <float.h>
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/context.h"
+#include "p2d/memory.h"
+#include "p2d/world.h"
+#include "p2d/joint.h"
+#include "p2d/island.h"
+#include "p2d/region.h"
+#include "internal.h"
+
+#define P2D_ISLAND_ARRAYS(X) \
+    X(int, p2d_islands.parent) \
+    X(float, p2d_islands.rest) \
+    X(struct p2d_object *, p2d_islands.head) \
+    X(struct p2d_object *, p2d_islands.tail)
+
+bool p2d_islands_reserve(int capacity) {
+    if(capacity <= p2d_islands.capacity) {
+        return true;
+    }
+
+    size_t old_capacity = (size_t)p2d_islands.capacity;
+    size_t new_capacity = (size_t)capacity;
+
+    const struct p2d_column columns[] = {
+        #define X(type, name) {(void **)&name, sizeof(type)},
+        P2D_ISLAND_ARRAYS(X)
+        #undef X
+    };
+    if(!p2d_grow_columns(columns, (int)(sizeof(columns) / sizeof(columns[0])), old_capacity, new_capacity)) {
+        return false;
+    }
+
+    p2d_islands.capacity = capacity;
+    return true;
+}
+
+void p2d_islands_shutdown(void) {
+    #define X(type, name) \
+        p2d_free(name, (size_t)p2d_islands.capacity * sizeof(type)); \
+        name = NULL;
+    P2D_ISLAND_ARRAYS(X)
+    #undef X
+
+    p2d_islands.capacity = 0;
+}
+
+static int _p2d_island_find(int i) {
+    // path halving
+    while(p2d_islands.parent[i] != i) {
+        p2d_islands.parent[i] = p2d_islands.parent[p2d_islands.parent[i]];
+        i = p2d_islands.parent[i];
+    }
+    return i;
+}
+
+// static bodies don't carry islands, otherwise everything on the ground would be one island
+static bool _p2d_island_participates(int handle) {
+    int i = p2d_body_index(handle);
+    if(i < 0) {
+        return false;
+    }
+
+    uint8_t flags = p2d_bodies.flags[i];
+    return !(flags & (P2D_BODY_FROZEN | P2D_BODY_INACTIVE));
+}
+
+void p2d_islands_begin(void) {
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        int h = p2d_bodies.handle[i];
+        p2d_islands.parent[h] = h;
+    }
+}
+
+void p2d_islands_add(int handle) {
+    p2d_islands.parent[handle] = handle;
+}
+
+void p2d_islands_link(int a, int b) {
+    if(!_p2d_island_participates(a) || !_p2d_island_participates(b)) {
+        return;
+    }
+
+    int root_a = _p2d_island_find(a);
+    int root_b = _p2d_island_find(b);
+
+    if(root_a != root_b) {
+        p2d_islands.parent[root_a] = root_b;
+    }
+}
+
+void p2d_islands_update(float delta_time) {
+    p2d_state.p2d_island_count = 0;
+
+    if(!p2d_state.p2d_rest_sleeping) {
+        return;
+    }
+
+    // joints are constraints too, so they glue their bodies into one island
+    for(int i = 0; i < p2d_state.p2d_joint_count; i++) {
+        struct p2d_joint *joint = p2d_joints[i];
+        if(joint->anchored_to_world) {
+            continue;
+        }
+
+        p2d_islands_link(joint->a->handle, joint->b->handle);
+    }
+
+    float linear_sq = p2d_state.p2d_sleep_linear_threshold * p2d_state.p2d_sleep_linear_threshold;
+
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        int h = p2d_bodies.handle[i];
+        p2d_islands.rest[h] = FLT_MAX;
+        p2d_islands.head[h] = NULL;
+        p2d_islands.tail[h] = NULL;
+    }
+
+    /*
+        Advance rest timers, and track the least rested body of each island
+    */
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        if(p2d_bodies.flags[i] & (P2D_BODY_FROZEN | P2D_BODY_INACTIVE)) {
+            continue;
+        }
+
+        struct p2d_object *object = p2d_objects[i];
+        float vx = p2d_bodies.vx[i];
+        float vy = p2d_bodies.vy[i];
+
+        float speed_sq = vx * vx + vy * vy;
+        if(speed_sq > linear_sq || fabsf(p2d_bodies.vr[i]) > p2d_state.p2d_sleep_angular_threshold) {
+            object->sleep_time = 0.0f;
+        }
+        else {
+            object->sleep_time += delta_time;
+        }
+
+        int root = _p2d_island_find(p2d_bodies.handle[i]);
+        p2d_islands.rest[root] = fminf(p2d_islands.rest[root], object->sleep_time);
+    }
+
+    /*
+        Chain every island member into a list, so the island can be woken from any body
+    */
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        if(p2d_bodies.flags[i] & (P2D_BODY_FROZEN | P2D_BODY_INACTIVE)) {
+            continue;
+        }
+
+        struct p2d_object *object = p2d_objects[i];
+        int root = _p2d_island_find(p2d_bodies.handle[i]);
+        if(p2d_islands.head[root] == NULL) {
+            p2d_state.p2d_island_count++;
+            p2d_islands.tail[root] = object;
+        }
+
+        object->island_next = p2d_islands.head[root];
+        p2d_islands.head[root] = object;
+    }
+
+    /*
+        Sleep every island that has been resting for long enough
+    */
+    bool slept = false;
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        int root = p2d_bodies.handle[i];
+        if(p2d_islands.parent[root] != root || p2d_islands.head[root] == NULL) {
+            continue;
+        }
+
+        if(p2d_islands.rest[root] < p2d_state.p2d_sleep_time) {
+            // awake islands don't keep a ring
+            for(struct p2d_object *it = p2d_islands.head[root]; it != NULL;) {
+                struct p2d_object *next = it->island_next;
+                it->island_next = NULL;
+                it = next;
+            }
+            continue;
+        }
+
+        // close the ring
+        p2d_islands.tail[root]->island_next = p2d_islands.head[root];
+
+        struct p2d_object *it = p2d_islands.head[root];
+        do {
+            int j = p2d_body_index(it->handle);
+            it->sleeping = true;
+            p2d_bodies.flags[j] |= P2D_BODY_SLEEPING;
+            p2d_bodies.vx[j] = 0.0f;
+            p2d_bodies.vy[j] = 0.0f;
+            p2d_bodies.vr[j] = 0.0f;
+            // the last rebuild was before the last solve moved it, and gather won't look again
+            p2d_body_update_aabb(j);
+            it = it->island_next;
+        } while(it != p2d_islands.head[root]);
+
+        slept = true;
+    }
+
+    if(slept) {
+        p2d_world_mark_resting_dirty();
+    }
+}
+
+void p2d_wake_object(struct p2d_object *object) {
+    if(!object) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_wake_object: object is NULL.\n");
+        return;
+    }
+
+    object->sleep_time = 0.0f;
+
+    // it may have been moved into a region, let the next step decide again
+    p2d_release_culled_object(object);
+
+    if(!object->sleeping) {
+        return;
+    }
+
+    struct p2d_object *it = object;
+    do {
+        struct p2d_object *next = it->island_next;
+        it->sleeping = false;
+        it->sleep_time = 0.0f;
+        int j = p2d_body_index(it->handle);
+        if(j >= 0) {
+            p2d_bodies.flags[j] &= (uint8_t)~P2D_BODY_SLEEPING;
+            p2d_bodies.flags[j] |= P2D_BODY_TOUCHED;
+        }
+        it->island_next = NULL;
+        it = next;
+    } while(it != NULL && it != object);
+
+    p2d_world_mark_resting_dirty();
+}
@@ -0,0 +1,353 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <stdint.h>
+
+#include "p2d/log.h"
+#include "p2d/jobs.h"
+#include "p2d/export.h"
+#include "p2d/context.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+
+    typedef HANDLE p2d_thread;
+    typedef SRWLOCK p2d_mutex;
+    typedef CONDITION_VARIABLE p2d_cond;
+
+    #define P2D_ATOMIC_ADD(ptr, value) InterlockedExchangeAdd((volatile LONG *)(ptr), (LONG)(value))
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+
+    typedef pthread_t p2d_thread;
+    typedef pthread_mutex_t p2d_mutex;
+    typedef pthread_cond_t p2d_cond;
+
+    #define P2D_ATOMIC_ADD(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_RELAXED)
+#endif
+
+// one per thread, padded so threads claiming from their own block don't share cache lines
+struct p2d_job_block {
+    volatile int next;
+    int end;
+    char pad[64 - 2 * sizeof(int)];
+};
+
+struct p2d_job_batch {
+    p2d_job_fn fn;
+    void *data;
+    p2d_world_t *world; // the caller's active world, jobs run on it too
+    int grain;
+    int blocks;
+    int pending; // pool threads still working on it
+    struct p2d_job_block block[P2D_MAX_THREADS];
+};
+
+static struct {
+    bool running;
+    bool quit;
+    int threads; // including the caller
+    unsigned int generation;
+
+    p2d_thread handles[P2D_MAX_THREADS];
+    p2d_mutex lock;
+    p2d_cond wake;
+    p2d_cond done;
+
+    // only one caller at a time gets the pool
+    p2d_mutex submit;
+
+    struct p2d_job_batch *batch;
+
+    // when set, parallel fors go to the engine's scheduler instead
+    bool has_scheduler;
+    struct p2d_scheduler scheduler;
+} pool = {0};
+
+// set while running inside a job, so nested parallel fors don't wait on the pool
+static P2D_THREAD_LOCAL bool in_job = false;
+
+//
+// PLATFORM
+//
+
+#ifdef _WIN32
+static void _p2d_mutex_init(p2d_mutex *m) { InitializeSRWLock(m); }
+static void _p2d_mutex_destroy(p2d_mutex *m) { (void)m; }
+static void _p2d_mutex_lock(p2d_mutex *m) { AcquireSRWLockExclusive(m); }
+static bool _p2d_mutex_trylock(p2d_mutex *m) { return TryAcquireSRWLockExclusive(m) != 0; }
+static void _p2d_mutex_unlock(p2d_mutex *m) { ReleaseSRWLockExclusive(m); }
+static void _p2d_cond_init(p2d_cond *c) { InitializeConditionVariable(c); }
+static void _p2d_cond_destroy(p2d_cond *c) { (void)c; }
+static void _p2d_cond_wait(p2d_cond *c, p2d_mutex *m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+static void _p2d_cond_signal(p2d_cond *c) { WakeConditionVariable(c); }
+static void _p2d_cond_broadcast(p2d_cond *c) { WakeAllConditionVariable(c); }
+
+static int _p2d_hardware_threads(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+#else
+static void _p2d_mutex_init(p2d_mutex *m) { pthread_mutex_init(m, NULL); }
+static void _p2d_mutex_destroy(p2d_mutex *m) { pthread_mutex_destroy(m); }
+static void _p2d_mutex_lock(p2d_mutex *m) { pthread_mutex_lock(m); }
+static bool _p2d_mutex_trylock(p2d_mutex *m) { return pthread_mutex_trylock(m) == 0; }
+static void _p2d_mutex_unlock(p2d_mutex *m) { pthread_mutex_unlock(m); }
+static void _p2d_cond_init(p2d_cond *c) { pthread_cond_init(c, NULL); }
+static void _p2d_cond_destroy(p2d_cond *c) { pthread_cond_destroy(c); }
+static void _p2d_cond_wait(p2d_cond *c, p2d_mutex *m) { pthread_cond_wait(c, m); }
+static void _p2d_cond_signal(p2d_cond *c) { pthread_cond_signal(c); }
+static void _p2d_cond_broadcast(p2d_cond *c) { pthread_cond_broadcast(c); }
+
+static int _p2d_hardware_threads(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+#endif
+
+//
+// WORK
+//
+
+// run our own block first, then steal from everyone else's, in a fixed order per thread
+static void _p2d_jobs_work(struct p2d_job_batch *batch, int self) {
+    bool was_in_job = in_job;
+    p2d_world_t *was_active = p2d_active_world;
+    in_job = true;
+    p2d_active_world = batch->world;
+
+    for(int k = 0; k < batch->blocks; k++) {
+        struct p2d_job_block *block = &batch->block[(self + k) % batch->blocks];
+
+        for(;;) {
+            int begin = P2D_ATOMIC_ADD(&block->next, batch->grain);
+            if(begin >= block->end) {
+                break;
+            }
+
+            int end = begin + batch->grain;
+            if(end > block->end) {
+                end = block->end;
+            }
+
+            batch->fn(batch->data, begin, end, self);
+        }
+    }
+
+    p2d_active_world = was_active;
+    in_job = was_in_job;
+}
+
+// same as above, for ranges handed out by the engine's scheduler
+static void _p2d_jobs_scheduled(void *data, int begin, int end, int thread) {
+    struct p2d_job_batch *batch = data;
+
+    bool was_in_job = in_job;
+    p2d_world_t *was_active = p2d_active_world;
+    in_job = true;
+    p2d_active_world = batch->world;
+
+    batch->fn(batch->data, begin, end, thread);
+
+    p2d_active_world = was_active;
+    in_job = was_in_job;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI _p2d_jobs_thread(LPVOID arg) {
+#else
+static void *_p2d_jobs_thread(void *arg) {
+#endif
+    int self = (int)(intptr_t)arg;
+    unsigned int seen = 0;
+
+    _p2d_mutex_lock(&pool.lock);
+    for(;;) {
+        while(!pool.quit && pool.generation == seen) {
+            _p2d_cond_wait(&pool.wake, &pool.lock);
+        }
+
+        if(pool.quit) {
+            break;
+        }
+
+        seen = pool.generation;
+        struct p2d_job_batch *batch = pool.batch;
+        _p2d_mutex_unlock(&pool.lock);
+
+        _p2d_jobs_work(batch, self);
+
+        _p2d_mutex_lock(&pool.lock);
+        if(--batch->pending == 0) {
+            _p2d_cond_signal(&pool.done);
+        }
+    }
+    _p2d_mutex_unlock(&pool.lock);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+//
+// POOL
+//
+
+bool p2d_jobs_init(int threads) {
+    p2d_jobs_shutdown();
+
+    if(threads <= 0) {
+        threads = _p2d_hardware_threads();
+    }
+    if(threads > P2D_MAX_THREADS) {
+        threads = P2D_MAX_THREADS;
+    }
+
+    if(threads == 1) {
+        return true;
+    }
+
+    _p2d_mutex_init(&pool.lock);
+    _p2d_mutex_init(&pool.submit);
+    _p2d_cond_init(&pool.wake);
+    _p2d_cond_init(&pool.done);
+    pool.quit = false;
+    pool.generation = 0;
+    pool.batch = NULL;
+
+    // thread 0 is whoever calls p2d_parallel_for()
+    pool.threads = 1;
+    for(int i = 1; i < threads; i++) {
+#ifdef _WIN32
+        pool.handles[i] = CreateThread(NULL, 0, _p2d_jobs_thread, (LPVOID)(intptr_t)i, 0, NULL);
+        bool started = pool.handles[i] != NULL;
+#else
+        bool started = pthread_create(&pool.handles[i], NULL, _p2d_jobs_thread, (void *)(intptr_t)i) == 0;
+#endif
+        if(!started) {
+            p2d_logf(P2D_LOG_WARN, "p2d_jobs_init: only started %d of %d threads.\n", pool.threads, threads);
+            break;
+        }
+        pool.threads++;
+    }
+
+    pool.running = true;
+    return true;
+}
+
+void p2d_jobs_shutdown(void) {
+    if(!pool.running) {
+        return;
+    }
+
+    _p2d_mutex_lock(&pool.lock);
+    pool.quit = true;
+    _p2d_cond_broadcast(&pool.wake);
+    _p2d_mutex_unlock(&pool.lock);
+
+    for(int i = 1; i < pool.threads; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool.handles[i], INFINITE);
+        CloseHandle(pool.handles[i]);
+#else
+        pthread_join(pool.handles[i], NULL);
+#endif
+    }
+
+    _p2d_cond_destroy(&pool.wake);
+    _p2d_cond_destroy(&pool.done);
+    _p2d_mutex_destroy(&pool.lock);
+    _p2d_mutex_destroy(&pool.submit);
+
+    pool.running = false;
+    pool.threads = 0;
+}
+
+void p2d_jobs_set_scheduler(const struct p2d_scheduler *scheduler) {
+    if(scheduler && (!scheduler->parallel_for || scheduler->threads < 1 || scheduler->threads > P2D_MAX_THREADS)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_jobs_set_scheduler: needs parallel_for and 1 to %d threads.\n", P2D_MAX_THREADS);
+        return;
+    }
+
+    pool.has_scheduler = scheduler != NULL;
+    if(scheduler) {
+        pool.scheduler = *scheduler;
+    }
+}
+
+int p2d_jobs_thread_count(void) {
+    if(pool.has_scheduler) {
+        return pool.scheduler.threads;
+    }
+    return pool.running ? pool.threads : 1;
+}
+
+bool p2d_jobs_parallel(int count, int grain) {
+    if(in_job || count <= (grain < 1 ? 1 : grain)) {
+        return false;
+    }
+    return pool.has_scheduler || (pool.running && pool.threads > 1);
+}
+
+void p2d_parallel_for(int count, int grain, p2d_job_fn fn, void *data) {
+    if(count <= 0) {
+        return;
+    }
+    if(grain < 1) {
+        grain = 1;
+    }
+
+    if(pool.has_scheduler && !in_job && count > grain) {
+        struct p2d_job_batch batch;
+        batch.fn = fn;
+        batch.data = data;
+        batch.world = p2d_active_world;
+        pool.scheduler.parallel_for(count, grain, _p2d_jobs_scheduled, &batch, pool.scheduler.user);
+        return;
+    }
+
+    // serial fallback
+    if(pool.has_scheduler || !pool.running || pool.threads < 2 || count <= grain || in_job || !_p2d_mutex_trylock(&pool.submit)) {
+        fn(data, 0, count, 0);
+        return;
+    }
+
+    struct p2d_job_batch batch;
+    batch.fn = fn;
+    batch.data = data;
+    batch.world = p2d_active_world;
+    batch.grain = grain;
+    batch.blocks = pool.threads;
+    batch.pending = pool.threads - 1;
+
+    // contiguous blocks, thread t always starts on the t-th slice of the range
+    for(int t = 0; t < batch.blocks; t++) {
+        batch.block[t].next = (int)((long long)count * t / batch.blocks);
+        batch.block[t].end = (int)((long long)count * (t + 1) / batch.blocks);
+    }
+
+    _p2d_mutex_lock(&pool.lock);
+    pool.batch = &batch;
+    pool.generation++;
+    _p2d_cond_broadcast(&pool.wake);
+    _p2d_mutex_unlock(&pool.lock);
+
+    _p2d_jobs_work(&batch, 0);
+
+    _p2d_mutex_lock(&pool.lock);
+    while(batch.pending > 0) {
+        _p2d_cond_wait(&pool.done, &pool.lock);
+    }
+    pool.batch = NULL;
+    _p2d_mutex_unlock(&pool.lock);
+
+    _p2d_mutex_unlock(&pool.submit);
+}
@@ -11,31 +11,71 @@
 #include <Lilith.h>
 
 #include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/context.h"
 #include "p2d/joint.h"
+#include "p2d/memory.h"
 #include "p2d/helpers.h"
+#include "p2d/solver.h"
+#include "internal.h"
 
-struct p2d_joint * p2d_joints[P2D_MAX_JOINTS] = {NULL};
+bool p2d_joints_reserve(int capacity) {
+    int old_capacity = p2d_state.p2d_joint_capacity;
+    if(capacity <= old_capacity) {
+        return true;
+    }
 
-void p2d_add_joint(struct p2d_joint *joint) {
-    for(int i = 0; i < P2D_MAX_JOINTS; i++) {
-        if(p2d_joints[i] == NULL) {
-            p2d_joints[i] = joint;
-            return;
+    struct p2d_joint **joints = p2d_realloc(p2d_joints, (size_t)old_capacity * sizeof(*joints), (size_t)capacity * sizeof(*joints));
+    if(!joints) {
+        return false;
+    }
+
+    p2d_joints = joints;
+    p2d_state.p2d_joint_capacity = capacity;
+    return true;
+}
+
+bool p2d_add_joint(struct p2d_joint *joint) {
+    if(!joint) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_add_joint: joint is NULL.\n");
+        return false;
+    }
+
+    int count = p2d_state.p2d_joint_count;
+    if(count == p2d_state.p2d_joint_capacity) {
+        int grown = count ? count * 2 : P2D_DEFAULT_JOINT_CAPACITY;
+        if(!p2d_joints_reserve(grown)) {
+            p2d_logf(P2D_LOG_ERROR, "p2d_add_joint: could not grow past %d joints.\n", count);
+            return false;
         }
     }
+
+    p2d_joints[count] = joint;
+    p2d_state.p2d_joint_count++;
+    return true;
 }
 
 void p2d_remove_joint(struct p2d_joint *joint) {
-    for(int i = 0; i < P2D_MAX_JOINTS; i++) {
+    int count = p2d_state.p2d_joint_count;
+    for(int i = 0; i < count; i++) {
         if(p2d_joints[i] == joint) {
-            p2d_joints[i] = NULL;
+            // keep the rest in order, joints are solved in the order they were added
+            memmove(&p2d_joints[i], &p2d_joints[i + 1], (size_t)(count - i - 1) * sizeof(*p2d_joints));
+            p2d_state.p2d_joint_count--;
             return;
         }
     }
 }
 
 void p2d_remove_all_joints(void) {
-    memset(p2d_joints, 0, sizeof(p2d_joints));
+    p2d_state.p2d_joint_count = 0;
+}
+
+void p2d_joints_shutdown(void) {
+    p2d_free(p2d_joints, (size_t)p2d_state.p2d_joint_capacity * sizeof(*p2d_joints));
+    p2d_joints = NULL;
+    p2d_state.p2d_joint_count = 0;
+    p2d_state.p2d_joint_capacity = 0;
 }
 
 vec2_t p2d_get_joint_world_anchor(struct p2d_object *object, vec2_t local_anchor) {
@@ -157,7 +197,7 @@ void _p2d_resolve_hinge_joint(struct p2d_joint *joint, float deltatime) {
             *b->out_x += anchor_diff.x;
             *b->out_y += anchor_diff.y;
         }
-    } else if(anchored_to_world) {
+    } else if(anchored_to_world || b->is_static) {
         a->x -= anchor_diff.x;
         a->y -= anchor_diff.y;
 
@@ -215,14 +255,116 @@ void _p2d_resolve_joint(struct p2d_joint *joint, float delta_time) {
     }
 }
 
+static bool _p2d_object_is_idle(struct p2d_object *object) {
+    int i = p2d_body_index(object->handle);
+    return i < 0 || (p2d_bodies.flags[i] & P2D_BODY_FROZEN) != 0;
+}
+
+// a joint with nothing simulated on either end has nothing to solve
+static bool _p2d_joint_is_asleep(struct p2d_joint *joint) {
+    if(!_p2d_object_is_idle(joint->a)) {
+        return false;
+    }
+
+    if(joint->anchored_to_world) {
+        return true;
+    }
+
+    return _p2d_object_is_idle(joint->b);
+}
+
+// conflicts only come from ends that can move, -1 for frozen ones (and the world)
+static int _p2d_joint_body(struct p2d_object *object) {
+    int i = p2d_body_index(object->handle);
+    if(i < 0 || (p2d_bodies.flags[i] & P2D_BODY_FROZEN)) {
+        return -1;
+    }
+    return object->handle;
+}
+
+/*
+    A sleeping, culled or parked end isn't simulated this step, so nothing written to it would
+    be scattered, snapshotted or hashed. The joint sees it as static instead.
+*/
+static void _p2d_joint_proxy(int i, struct p2d_object *proxy) {
+    p2d_body_proxy(i, proxy);
+    if(p2d_bodies.flags[i] & P2D_BODY_FROZEN) {
+        proxy->is_static = true;
+        proxy->inv_mass = 0.0f;
+        proxy->inv_inertia = 0.0f;
+    }
+}
+
+static void _p2d_resolve_joint_range(void *data, int begin, int end, int thread) {
+    const float *dt = data;
+    const struct p2d_color_batches *batches = &p2d_solver.joint_batches;
+    (void)thread;
+
+    for(int n = begin; n < end; n++) {
+        struct p2d_joint *joint = p2d_joints[batches->order[n]];
+        if(_p2d_joint_is_asleep(joint)) {
+            continue;
+        }
+
+        // solve on body store proxies, then store what changed back
+        struct p2d_object a, b;
+        struct p2d_joint solved = *joint;
+
+        int ia = p2d_body_index(joint->a->handle);
+        int ib = joint->anchored_to_world ? -1 : p2d_body_index(joint->b->handle);
+        if(ia < 0 || (!joint->anchored_to_world && ib < 0)) {
+            continue;
+        }
+
+        _p2d_joint_proxy(ia, &a);
+        solved.a = &a;
+        if(!joint->anchored_to_world) {
+            _p2d_joint_proxy(ib, &b);
+            solved.b = &b;
+        }
+
+        _p2d_resolve_joint(&solved, *dt);
+
+        // static and frozen ends can be shared by joints of the same color, they are only read
+        if(!a.is_static) {
+            p2d_body_store_pose(ia, &a);
+            p2d_body_store_velocity(ia, &a);
+        }
+        if(!joint->anchored_to_world && !b.is_static) {
+            p2d_body_store_pose(ib, &b);
+            p2d_body_store_velocity(ib, &b);
+        }
+    }
+}
+
 void p2d_resolve_joints(float delta_time, int substeps) {
 
     float dt = delta_time / substeps;
 
-    for(int i = 0; i < P2D_MAX_JOINTS; i++) {
+    int count = p2d_state.p2d_joint_count;
+    if(count == 0) {
+        return;
+    }
+
+    int *bodies = p2d_constraint_bodies(count);
+    if(!bodies) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_resolve_joints: out of memory.\n");
+        return;
+    }
+
+    for(int i = 0; i < count; i++) {
         struct p2d_joint *joint = p2d_joints[i];
-        if(joint != NULL) {
-            _p2d_resolve_joint(joint, dt);
-        }
+        bool idle = _p2d_joint_is_asleep(joint);
+
+        bodies[2 * i] = idle ? -1 : _p2d_joint_body(joint->a);
+        bodies[2 * i + 1] = (idle || joint->anchored_to_world) ? -1 : _p2d_joint_body(joint->b);
+    }
+
+    // joints sharing a body go in different colors, each color is solved in parallel
+    if(!p2d_color_constraints(bodies, count, &p2d_solver.joint_batches)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_resolve_joints: out of memory.\n");
+        return;
     }
+
+    p2d_solve_batches(&p2d_solver.joint_batches, _p2d_resolve_joint_range, &dt);
 }
@@ -8,12 +8,13 @@
 #include <stdarg.h>
 
 #include "p2d/log.h"
-
-char buffer[2048];
+#include "p2d/context.h"
+#include "internal.h"
 
 void p2d_logf(enum p2d_log_level lvl, const char *fmt, ...) {
     // if we have an external logging function, use it
     if(p2d_state.log) {
+        char buffer[2048]; // on the stack, worlds may be logging from several threads
         va_list args;
         va_start(args, fmt);
         vsnprintf(buffer, sizeof(buffer), fmt, args);
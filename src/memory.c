@@ -0,0 +1,133 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/core.h"
+#include "p2d/context.h"
+#include "p2d/memory.h"
+#include "internal.h"
+
+// job threads grow their own scratch arrays, so the running total is updated atomically
+#ifdef _WIN32
+    #include <windows.h>
+
+    #ifdef _WIN64
+        #define P2D_ATOMIC_CAS_SIZE(ptr, expected, desired) \
+            ((size_t)InterlockedCompareExchange64((volatile LONG64 *)(ptr), (LONG64)(desired), (LONG64)(expected)) == (expected))
+    #else
+        #define P2D_ATOMIC_CAS_SIZE(ptr, expected, desired) \
+            ((size_t)InterlockedCompareExchange((volatile LONG *)(ptr), (LONG)(desired), (LONG)(expected)) == (expected))
+    #endif
+#else
+    #define P2D_ATOMIC_CAS_SIZE(ptr, expected, desired) \
+        __atomic_compare_exchange_n((ptr), &(expected), (desired), false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#endif
+
+// move the total from old_size to new_size bytes, false if growing would go over budget
+static bool _p2d_memory_account(size_t old_size, size_t new_size) {
+    size_t *used = &p2d_state.p2d_memory_used;
+    for(;;) {
+        size_t current = *(volatile size_t *)used;
+        size_t next = current - old_size + new_size;
+        if(new_size > old_size && p2d_state.p2d_memory_budget != 0 && next > p2d_state.p2d_memory_budget) {
+            return false;
+        }
+        if(P2D_ATOMIC_CAS_SIZE(used, current, next)) {
+            return true;
+        }
+    }
+}
+
+bool p2d_memory_fits(size_t extra) {
+    if(p2d_state.p2d_memory_budget == 0) {
+        return true;
+    }
+    return p2d_state.p2d_memory_used + extra <= p2d_state.p2d_memory_budget;
+}
+
+void *p2d_alloc(size_t size) {
+    return p2d_realloc(NULL, 0, size);
+}
+
+void *p2d_realloc(void *ptr, size_t old_size, size_t new_size) {
+    // claimed up front, so threads growing at the same time can't overshoot the budget together
+    if(!_p2d_memory_account(old_size, new_size)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_realloc: memory budget of %zu bytes exceeded.\n", p2d_state.p2d_memory_budget);
+        return NULL;
+    }
+
+    void *grown = realloc(ptr, new_size);
+    if(!grown) {
+        _p2d_memory_account(new_size, old_size);
+        p2d_logf(P2D_LOG_ERROR, "p2d_realloc: failed to allocate memory.\n");
+        return NULL;
+    }
+
+    if(new_size > old_size) {
+        memset((char *)grown + old_size, 0, new_size - old_size);
+    }
+    return grown;
+}
+
+void p2d_free(void *ptr, size_t size) {
+    if(!ptr) {
+        return;
+    }
+
+    free(ptr);
+    _p2d_memory_account(size, 0);
+}
+
+bool p2d_grow_columns(const struct p2d_column *columns, int count, size_t old_capacity, size_t new_capacity) {
+    if(count > P2D_MAX_COLUMNS) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_grow_columns: %d columns, at most %d.\n", count, P2D_MAX_COLUMNS);
+        return false;
+    }
+
+    void *grown[P2D_MAX_COLUMNS];
+    for(int c = 0; c < count; c++) {
+        grown[c] = p2d_alloc(new_capacity * columns[c].size);
+        if(!grown[c]) {
+            while(c-- > 0) {
+                p2d_free(grown[c], new_capacity * columns[c].size);
+            }
+            return false;
+        }
+    }
+
+    for(int c = 0; c < count; c++) {
+        if(old_capacity > 0) {
+            memcpy(grown[c], *columns[c].items, old_capacity * columns[c].size);
+        }
+        p2d_free(*columns[c].items, old_capacity * columns[c].size);
+        *columns[c].items = grown[c];
+    }
+    return true;
+}
+
+bool p2d_grow(void **items, int *capacity, int needed, size_t size) {
+    if(needed <= *capacity) {
+        return true;
+    }
+
+    int grown = *capacity ? *capacity * 2 : 256;
+    while(grown < needed) {
+        grown *= 2;
+    }
+
+    void *resized = p2d_realloc(*items, (size_t)*capacity * size, (size_t)grown * size);
+    if(!resized) {
+        return false;
+    }
+
+    *items = resized;
+    *capacity = grown;
+    return true;
+}
@@ -0,0 +1,386 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/core.h"
+#include "p2d/body.h"
+#include "p2d/jobs.h"
+#include "p2d/world.h"
+#include "p2d/collide.h"
+#include "p2d/context.h"
+#include "p2d/memory.h"
+#include "p2d/contacts.h"
+#include "p2d/narrowphase.h"
+#include "internal.h"
+
+//
+// CANDIDATES
+//
+
+static unsigned long long _p2d_pair_key(int a, int b) {
+    unsigned long long lo = (unsigned long long)(a < b ? a : b);
+    unsigned long long hi = (unsigned long long)(a < b ? b : a);
+
+    // never 0, that marks an empty slot
+    return ((lo + 1) << 32) | (hi + 1);
+}
+
+static int _p2d_seen_slot(unsigned long long key) {
+    // fibonacci hashing, capacity is a power of two
+    unsigned long long mixed = key * 0x9E3779B97F4A7C15ull;
+    return (int)((mixed >> 32) & (unsigned long long)(p2d_narrowphase.seen_capacity - 1));
+}
+
+static bool _p2d_seen_rehash(int capacity) {
+    unsigned long long *old = p2d_narrowphase.seen;
+    int old_capacity = p2d_narrowphase.seen_capacity;
+
+    unsigned long long *seen = p2d_alloc((size_t)capacity * sizeof(*seen));
+    if(!seen) {
+        return false;
+    }
+
+    p2d_narrowphase.seen = seen;
+    p2d_narrowphase.seen_capacity = capacity;
+
+    for(int i = 0; i < old_capacity; i++) {
+        if(old[i] == 0) {
+            continue;
+        }
+
+        int slot = _p2d_seen_slot(old[i]);
+        while(seen[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        seen[slot] = old[i];
+    }
+
+    p2d_free(old, (size_t)old_capacity * sizeof(*old));
+    return true;
+}
+
+// false if the pair was already listed this substep
+static bool _p2d_seen_add(int a, int b) {
+    // keep it at most half full
+    if((p2d_narrowphase.seen_count + 1) * 2 > p2d_narrowphase.seen_capacity) {
+        int capacity = p2d_narrowphase.seen_capacity ? p2d_narrowphase.seen_capacity * 2 : 1024;
+        if(!_p2d_seen_rehash(capacity)) {
+            // can't dedup, the pair table in p2d_step() still catches it
+            return true;
+        }
+    }
+
+    unsigned long long key = _p2d_pair_key(a, b);
+    int slot = _p2d_seen_slot(key);
+    while(p2d_narrowphase.seen[slot] != 0) {
+        if(p2d_narrowphase.seen[slot] == key) {
+            return false;
+        }
+        slot = (slot + 1) & (p2d_narrowphase.seen_capacity - 1);
+    }
+
+    p2d_narrowphase.seen[slot] = key;
+    p2d_narrowphase.seen_count++;
+    return true;
+}
+
+// the checks that only need the body flags, the rest happen in the narrow phase
+static void _p2d_add_candidate(struct p2d_world_node *node_a, struct p2d_world_node *node_b, int flags, bool sensors) {
+    int ia = p2d_body_index(node_a->handle);
+    int ib = p2d_body_index(node_b->handle);
+    if(ia < 0 || ib < 0) {
+        return;
+    }
+
+    uint8_t flags_a = p2d_bodies.flags[ia];
+    uint8_t flags_b = p2d_bodies.flags[ib];
+    uint8_t fixed = P2D_BODY_STATIC | P2D_BODY_PARKED;
+
+    // parked objects are immovable for this step, two of them have nothing to resolve
+    if((flags_a & fixed) && (flags_b & fixed)) {
+        return;
+    }
+
+    // sleeping objects only ever meet awake ones here, and only moving ones should wake them
+    if((flags_a | flags_b) & P2D_BODY_SLEEPING) {
+        uint8_t awake = (flags_a & P2D_BODY_SLEEPING) ? flags_b : flags_a;
+        if(awake & (P2D_BODY_SLEEPING | fixed)) {
+            return;
+        }
+    }
+
+    // triggers only sense, once a step, and only bodies on the trigger layers
+    struct p2d_candidate **list = &p2d_narrowphase.candidates;
+    int *listed = &p2d_narrowphase.candidate_count;
+    int *capacity = &p2d_narrowphase.candidate_capacity;
+    if((flags_a | flags_b) & P2D_BODY_TRIGGER) {
+        if(!sensors || ((flags_a & flags_b) & P2D_BODY_TRIGGER)) {
+            return;
+        }
+
+        int other = (flags_a & P2D_BODY_TRIGGER) ? ib : ia;
+        if(!(p2d_bodies.mask[other] & p2d_state.p2d_trigger_layers)) {
+            return;
+        }
+
+        list = &p2d_narrowphase.sensors;
+        listed = &p2d_narrowphase.sensor_count;
+        capacity = &p2d_narrowphase.sensor_capacity;
+    }
+
+    // multi grid node pairs are only tested once
+    if(!_p2d_seen_add(node_a->handle, node_b->handle)) {
+        return;
+    }
+
+    int count = *listed;
+    if(!p2d_grow((void **)list, capacity, count + 1, sizeof(struct p2d_candidate))) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_collect_candidates: out of memory, dropping pairs.\n");
+        return;
+    }
+
+    (*listed)++;
+    (*list)[count] = (struct p2d_candidate){
+        .a = node_a->handle,
+        .b = node_b->handle,
+        .flags = flags,
+        .thread = -1,
+        .manifold = -1
+    };
+}
+
+static int _p2d_compare_candidates(const void *a, const void *b) {
+    const struct p2d_candidate *ca = a;
+    const struct p2d_candidate *cb = b;
+    if(ca->a != cb->a) {
+        return (ca->a > cb->a) - (ca->a < cb->a);
+    }
+    return (ca->b > cb->b) - (ca->b < cb->b);
+}
+
+/*
+    Deterministic mode: the bucket walk order depends on the grid and the bucket count, so put the
+    pairs in handle order instead (lower handle first in each pair, every pair is listed only once)
+*/
+static void _p2d_sort_candidates(struct p2d_candidate *candidates, int count) {
+    for(int k = 0; k < count; k++) {
+        struct p2d_candidate *candidate = &candidates[k];
+        if(candidate->a > candidate->b) {
+            int swap = candidate->a;
+            candidate->a = candidate->b;
+            candidate->b = swap;
+        }
+    }
+
+    // nothing was found yet, so there may be no array at all
+    if(count > 1) {
+        qsort(candidates, (size_t)count, sizeof(struct p2d_candidate), _p2d_compare_candidates);
+    }
+}
+
+/*
+    For each bucket containing objects, list the pairs it makes with all other
+    objects in the bucket (excluding self), with every static object in that bucket,
+    and with every sleeping object resting in it
+*/
+int p2d_collect_candidates(bool sensors) {
+    p2d_narrowphase.candidate_count = 0;
+    p2d_narrowphase.sensor_count = 0;
+    if(p2d_narrowphase.seen_count > 0) {
+        memset(p2d_narrowphase.seen, 0, (size_t)p2d_narrowphase.seen_capacity * sizeof(*p2d_narrowphase.seen));
+        p2d_narrowphase.seen_count = 0;
+    }
+
+    // nothing has been pushed yet
+    int handles = p2d_bodies.handle_count;
+    if(p2d_grow((void **)&p2d_narrowphase.shift, &p2d_narrowphase.shift_capacity, handles, sizeof(vec2_t))) {
+        memset(p2d_narrowphase.shift, 0, (size_t)handles * sizeof(vec2_t));
+        p2d_narrowphase.shift_count = handles;
+    }
+    else {
+        p2d_logf(P2D_LOG_ERROR, "p2d_collect_candidates: out of memory, manifolds won't follow separation.\n");
+        p2d_narrowphase.shift_count = 0;
+    }
+
+    for(int used = 0; used < p2d_world_used_count; used++) {
+        int i = p2d_world_used[used];
+
+        for(struct p2d_world_node *node_a = p2d_world[i]; node_a; node_a = node_a->next) {
+            for(struct p2d_world_node *node_b = p2d_broadphase.statics[i]; node_b; node_b = node_b->next) {
+                p2d_state.p2d_contact_checks++;
+                _p2d_add_candidate(node_a, node_b, 0, sensors);
+            }
+
+            for(struct p2d_world_node *node_b = node_a->next; node_b; node_b = node_b->next) {
+                p2d_state.p2d_contact_checks++;
+                _p2d_add_candidate(node_a, node_b, 0, sensors);
+            }
+
+            for(struct p2d_world_node *node_b = p2d_world_resting[i]; node_b; node_b = node_b->next) {
+                p2d_state.p2d_contact_checks++;
+
+                // woken this substep, it will be back in the awake table next rebuild
+                int resting = p2d_body_index(node_b->handle);
+                if(resting >= 0 && (p2d_bodies.flags[resting] & P2D_BODY_SLEEPING)) {
+                    _p2d_add_candidate(node_a, node_b, P2D_CANDIDATE_RESTING, sensors);
+                }
+            }
+        }
+    }
+
+    if(p2d_state.p2d_deterministic) {
+        _p2d_sort_candidates(p2d_narrowphase.candidates, p2d_narrowphase.candidate_count);
+        _p2d_sort_candidates(p2d_narrowphase.sensors, p2d_narrowphase.sensor_count);
+    }
+
+    return p2d_narrowphase.candidate_count;
+}
+
+//
+// NARROW PHASE
+//
+
+static void _p2d_narrowphase_range(void *data, int begin, int end, int thread) {
+    struct p2d_manifold_list *list = &p2d_narrowphase.manifolds[thread];
+    (void)data;
+
+    for(int k = begin; k < end; k++) {
+        struct p2d_candidate *candidate = &p2d_narrowphase.candidates[k];
+        int ia = p2d_body_index(candidate->a);
+        int ib = p2d_body_index(candidate->b);
+
+        /*
+            last check - might be expensive (profile)
+            we want to see if they are even eligible to collide,
+            taking a collision mask and some other meta like if they revolute each other into account
+        */
+        if(!p2d_should_collide(p2d_objects[ia], p2d_objects[ib])) {
+            continue;
+        }
+
+        struct p2d_object pa, pb;
+        p2d_body_proxy(ia, &pa);
+        p2d_body_proxy(ib, &pb);
+
+        struct p2d_collision_info info = {0};
+        if(!p2d_collide(&pa, &pb, &info)) {
+            continue;
+        }
+
+        if(list->failed || !p2d_grow((void **)&list->items, &list->capacity, list->count + 1, sizeof(struct p2d_narrow_manifold))) {
+            list->failed = true;
+            continue;
+        }
+
+        struct p2d_narrow_manifold *manifold = &list->items[list->count];
+        manifold->info = info;
+        manifold->contact_count = 0;
+
+        struct p2d_contact_list *contacts = p2d_generate_contacts(&pa, &pb);
+        if(contacts) {
+            for(size_t c = 0; c < contacts->count && c < 2; c++) {
+                manifold->contacts[manifold->contact_count++] = contacts->contacts[c];
+            }
+            p2d_contact_list_destroy(contacts);
+        }
+
+        // only this thread ever touches this candidate
+        candidate->thread = thread;
+        candidate->manifold = list->count++;
+    }
+}
+
+void p2d_run_narrowphase(void) {
+    int threads = p2d_jobs_thread_count();
+    for(int t = 0; t < threads; t++) {
+        p2d_narrowphase.manifolds[t].count = 0;
+        p2d_narrowphase.manifolds[t].failed = false;
+    }
+
+    p2d_parallel_for(p2d_narrowphase.candidate_count, P2D_JOB_GRAIN, _p2d_narrowphase_range, NULL);
+
+    for(int t = 0; t < threads; t++) {
+        if(p2d_narrowphase.manifolds[t].failed) {
+            p2d_logf(P2D_LOG_ERROR, "p2d_run_narrowphase: out of memory, dropping contacts.\n");
+            break;
+        }
+    }
+}
+
+const struct p2d_narrow_manifold *p2d_candidate_manifold(const struct p2d_candidate *candidate) {
+    if(candidate->thread < 0) {
+        return NULL;
+    }
+    return &p2d_narrowphase.manifolds[candidate->thread].items[candidate->manifold];
+}
+
+//
+// SEPARATION
+//
+
+static vec2_t _p2d_shift(int handle) {
+    // bodies created mid step weren't around for the narrow phase
+    if(handle < 0 || handle >= p2d_narrowphase.shift_count) {
+        return (vec2_t){{0.0f, 0.0f}};
+    }
+    return p2d_narrowphase.shift[handle];
+}
+
+void p2d_narrowphase_moved(int handle, vec2_t delta) {
+    // static bodies are never pushed, and may be shared between threads in the solver
+    if(delta.x == 0.0f && delta.y == 0.0f) {
+        return;
+    }
+    if(handle < 0 || handle >= p2d_narrowphase.shift_count) {
+        return;
+    }
+    p2d_narrowphase.shift[handle].x += delta.x;
+    p2d_narrowphase.shift[handle].y += delta.y;
+}
+
+bool p2d_refresh_manifold(const struct p2d_candidate *candidate, struct p2d_narrow_manifold *manifold) {
+    vec2_t sa = _p2d_shift(candidate->a);
+    vec2_t sb = _p2d_shift(candidate->b);
+    if(sa.x == 0.0f && sa.y == 0.0f && sb.x == 0.0f && sb.y == 0.0f) {
+        return true;
+    }
+
+    // the normal points from a to b, b moving along it (relative to a) takes off penetration
+    vec2_t normal = manifold->info.normal;
+    float apart = (sb.x - sa.x) * normal.x + (sb.y - sa.y) * normal.y;
+
+    manifold->info.depth -= apart;
+    if(manifold->info.depth <= 0.0f) {
+        return false;
+    }
+
+    // contact points sit between the two surfaces, move them half way
+    vec2_t mid = {{(sa.x + sb.x) * 0.5f, (sa.y + sb.y) * 0.5f}};
+    for(int c = 0; c < manifold->contact_count; c++) {
+        manifold->contacts[c].contact_point.x += mid.x;
+        manifold->contacts[c].contact_point.y += mid.y;
+        manifold->contacts[c].penetration -= apart;
+    }
+
+    return true;
+}
+
+void p2d_narrowphase_shutdown(void) {
+    p2d_free(p2d_narrowphase.candidates, (size_t)p2d_narrowphase.candidate_capacity * sizeof(*p2d_narrowphase.candidates));
+    p2d_free(p2d_narrowphase.sensors, (size_t)p2d_narrowphase.sensor_capacity * sizeof(*p2d_narrowphase.sensors));
+    p2d_free(p2d_narrowphase.shift, (size_t)p2d_narrowphase.shift_capacity * sizeof(*p2d_narrowphase.shift));
+    p2d_free(p2d_narrowphase.seen, (size_t)p2d_narrowphase.seen_capacity * sizeof(*p2d_narrowphase.seen));
+
+    for(int t = 0; t < P2D_MAX_THREADS; t++) {
+        p2d_free(p2d_narrowphase.manifolds[t].items, (size_t)p2d_narrowphase.manifolds[t].capacity * sizeof(*p2d_narrowphase.manifolds[t].items));
+    }
+
+    memset(&p2d_narrowphase, 0, sizeof(p2d_narrowphase));
+}
@@ -8,22 +8,25 @@
 #include <stdlib.h>
 
 #include "p2d/pairs.h"
+#include "p2d/context.h"
+#include "internal.h"
 
-static struct p2d_pair_table pair_table;
-
+// by handle, not address, so the table looks the same on every run
 static size_t hash_pair(struct p2d_object *a, struct p2d_object *b) {
-    return (((size_t)a ^ (size_t)b) & (P2D_PAIR_BUCKET_COUNT - 1));
+    unsigned int lo = (unsigned int)(a->handle < b->handle ? a->handle : b->handle);
+    unsigned int hi = (unsigned int)(a->handle < b->handle ? b->handle : a->handle);
+    return (size_t)((lo * 73856093u) ^ (hi * 19349663u)) & (P2D_PAIR_BUCKET_COUNT - 1);
 }
 
 void p2d_pairs_init(void) {
     for(int i = 0; i < P2D_PAIR_BUCKET_COUNT; i++) {
-        pair_table.buckets[i] = NULL;
+        p2d_pairs.buckets[i] = NULL;
     }
 }
 
 bool p2d_collision_pair_exists(struct p2d_object *a, struct p2d_object *b) {
     size_t bucket = hash_pair(a, b);
-    struct p2d_pair_node *current = pair_table.buckets[bucket];
+    struct p2d_pair_node *current = p2d_pairs.buckets[bucket];
     
     while(current) {
         if((current->a == a && current->b == b) || 
@@ -45,8 +48,8 @@ bool p2d_add_collision_pair(struct p2d_object *a, struct p2d_object *b) {
     
     node->a = a;
     node->b = b;
-    node->next = pair_table.buckets[bucket];
-    pair_table.buckets[bucket] = node;
+    node->next = p2d_pairs.buckets[bucket];
+    p2d_pairs.buckets[bucket] = node;
     
     p2d_state.p2d_collision_pairs++;
 
@@ -55,13 +58,13 @@ bool p2d_add_collision_pair(struct p2d_object *a, struct p2d_object *b) {
 
 bool p2d_reset_collision_pairs(void) {
     for(int i = 0; i < P2D_PAIR_BUCKET_COUNT; i++) {
-        struct p2d_pair_node *current = pair_table.buckets[i];
+        struct p2d_pair_node *current = p2d_pairs.buckets[i];
         while(current) {
             struct p2d_pair_node *next = current->next;
             free(current);
             current = next;
         }
-        pair_table.buckets[i] = NULL;
+        p2d_pairs.buckets[i] = NULL;
     }
     p2d_state.p2d_collision_pairs = 0;
     return true;
@@ -0,0 +1,635 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/jobs.h"
+#include "p2d/world.h"
+#include "p2d/context.h"
+#include "p2d/memory.h"
+#include "p2d/helpers.h"
+#include "p2d/query.h"
+#include "internal.h"
+
+struct p2d_ray {
+    vec2_t origin;
+    vec2_t direction; // normalized
+    float max_distance;
+    uint16_t mask;
+};
+
+/*
+    Called for every cell a ray crosses, with the ray's distance where it leaves the cell.
+    Returns true to stop walking.
+*/
+typedef bool (*p2d_ray_cell_fn)(void *data, int hash, float t_exit);
+
+// a ray's walk, either keeping the closest hit or collecting every one
+struct p2d_ray_walk {
+    const struct p2d_ray *ray;
+    bool closest;
+    bool found;
+    struct p2d_raycast_hit best;
+};
+
+//
+// SHAPES
+//
+
+static bool _p2d_ray_circle(const struct p2d_ray *ray, const struct p2d_object *circle, float *distance, vec2_t *normal) {
+    float mx = ray->origin.x - circle->x;
+    float my = ray->origin.y - circle->y;
+    float r = circle->circle.radius;
+
+    float b = mx * ray->direction.x + my * ray->direction.y;
+    float c = mx * mx + my * my - r * r;
+
+    // starts inside, or points away
+    if(c <= 0.0f || b > 0.0f) {
+        return false;
+    }
+
+    float disc = b * b - c;
+    if(disc < 0.0f) {
+        return false;
+    }
+
+    float t = -b - sqrtf(disc);
+    *distance = t;
+    *normal = (vec2_t){{(mx + ray->direction.x * t) / r, (my + ray->direction.y * t) / r}};
+    return true;
+}
+
+// slabs in the box's own axes, taken from its corners so rotation goes the same way as everywhere else
+static bool _p2d_ray_box(const struct p2d_ray *ray, struct p2d_object *box, float *distance, vec2_t *normal) {
+    float w = box->rectangle.width;
+    float h = box->rectangle.height;
+    if(w <= 0.0f || h <= 0.0f) {
+        return false;
+    }
+
+    struct p2d_obb_verts verts = p2d_obb_to_verts(p2d_get_obb(box));
+    vec2_t axes[2] = {
+        {{(verts.verts[1].x - verts.verts[0].x) / w, (verts.verts[1].y - verts.verts[0].y) / w}},
+        {{(verts.verts[3].x - verts.verts[0].x) / h, (verts.verts[3].y - verts.verts[0].y) / h}}
+    };
+    float extents[2] = {w, h};
+
+    float dx = ray->origin.x - verts.verts[0].x;
+    float dy = ray->origin.y - verts.verts[0].y;
+
+    float t_enter = -FLT_MAX;
+    float t_exit = FLT_MAX;
+    int enter_axis = -1;
+    float enter_sign = 0.0f;
+    bool inside = true;
+
+    for(int a = 0; a < 2; a++) {
+        float local = dx * axes[a].x + dy * axes[a].y;
+        float along = ray->direction.x * axes[a].x + ray->direction.y * axes[a].y;
+        inside = inside && local > 0.0f && local < extents[a];
+
+        if(fabsf(along) < 1e-8f) {
+            if(local < 0.0f || local > extents[a]) {
+                return false;
+            }
+            continue;
+        }
+
+        float t0 = (0.0f - local) / along;
+        float t1 = (extents[a] - local) / along;
+        float sign = -1.0f; // entering through the 0 face
+        if(t0 > t1) {
+            float swap = t0;
+            t0 = t1;
+            t1 = swap;
+            sign = 1.0f;
+        }
+
+        if(t0 > t_enter) {
+            t_enter = t0;
+            enter_axis = a;
+            enter_sign = sign;
+        }
+        if(t1 < t_exit) {
+            t_exit = t1;
+        }
+        if(t_enter > t_exit) {
+            return false;
+        }
+    }
+
+    if(inside || enter_axis < 0 || t_enter < 0.0f) {
+        return false;
+    }
+
+    *distance = t_enter;
+    *normal = (vec2_t){{axes[enter_axis].x * enter_sign, axes[enter_axis].y * enter_sign}};
+    return true;
+}
+
+//
+// WALKING
+//
+
+// next stamp, with room in the table for every handle
+static bool _p2d_query_begin(void) {
+    struct p2d_query_store *q = &p2d_queries;
+
+    // new stamps come zeroed
+    if(!p2d_grow((void **)&q->stamps, &q->stamp_capacity, p2d_bodies.handle_count, sizeof(*q->stamps))) {
+        return false;
+    }
+
+    if(++q->stamp == 0) {
+        memset(q->stamps, 0, (size_t)q->stamp_capacity * sizeof(*q->stamps));
+        q->stamp = 1;
+    }
+    return true;
+}
+
+static void _p2d_ray_visit(struct p2d_ray_walk *walk, struct p2d_world_node *node) {
+    struct p2d_query_store *q = &p2d_queries;
+    const struct p2d_ray *ray = walk->ray;
+
+    for(; node; node = node->next) {
+        int h = node->handle;
+        if(q->stamps[h] == q->stamp) {
+            continue;
+        }
+        q->stamps[h] = q->stamp;
+
+        int i = p2d_body_index(h);
+        if(i < 0 || (p2d_bodies.flags[i] & P2D_BODY_TRIGGER) || !(p2d_bodies.mask[i] & ray->mask)) {
+            continue;
+        }
+
+        struct p2d_object proxy;
+        p2d_body_proxy(i, &proxy);
+
+        float distance;
+        vec2_t normal;
+        bool hit = proxy.type == P2D_OBJECT_CIRCLE ? _p2d_ray_circle(ray, &proxy, &distance, &normal) : _p2d_ray_box(ray, &proxy, &distance, &normal);
+        if(!hit || distance > ray->max_distance || (walk->closest && walk->found && distance >= walk->best.distance)) {
+            continue;
+        }
+
+        struct p2d_raycast_hit found = {
+            .object = p2d_objects[i],
+            .handle = h,
+            .point = {{ray->origin.x + ray->direction.x * distance, ray->origin.y + ray->direction.y * distance}},
+            .normal = normal,
+            .distance = distance
+        };
+
+        if(walk->closest) {
+            walk->best = found;
+            walk->found = true;
+        }
+        else if(p2d_grow((void **)&q->hits, &q->hit_capacity, q->hit_count + 1, sizeof(*q->hits))) {
+            q->hits[q->hit_count++] = found;
+        }
+        else {
+            p2d_logf(P2D_LOG_ERROR, "p2d_raycast_all: out of memory, dropping hits.\n");
+        }
+    }
+}
+
+static bool _p2d_ray_walk_cell(void *data, int hash, float t_exit) {
+    struct p2d_ray_walk *walk = data;
+    _p2d_ray_visit(walk, p2d_world[hash]);
+    _p2d_ray_visit(walk, p2d_world_resting[hash]);
+    _p2d_ray_visit(walk, p2d_broadphase.statics[hash]);
+
+    // nothing in the cells left can be nearer than what was found
+    return walk->closest && walk->found && walk->best.distance <= t_exit;
+}
+
+// DDA over the grid, cells in the order the ray crosses them until cell returns true
+static void _p2d_ray_cells(const struct p2d_ray *ray, p2d_ray_cell_fn cell, void *data) {
+    float size = (float)p2d_state.p2d_cell_size;
+    vec2_t o = ray->origin;
+    vec2_t d = ray->direction;
+
+    int tx = (int)floorf(o.x / size);
+    int ty = (int)floorf(o.y / size);
+    int step_x = d.x > 0.0f ? 1 : -1;
+    int step_y = d.y > 0.0f ? 1 : -1;
+
+    float t_max_x = d.x > 0.0f ? ((float)(tx + 1) * size - o.x) / d.x : d.x < 0.0f ? ((float)tx * size - o.x) / d.x : FLT_MAX;
+    float t_max_y = d.y > 0.0f ? ((float)(ty + 1) * size - o.y) / d.y : d.y < 0.0f ? ((float)ty * size - o.y) / d.y : FLT_MAX;
+    float t_delta_x = d.x != 0.0f ? size / fabsf(d.x) : FLT_MAX;
+    float t_delta_y = d.y != 0.0f ? size / fabsf(d.y) : FLT_MAX;
+
+    for(;;) {
+        float t_exit = fminf(fminf(t_max_x, t_max_y), ray->max_distance);
+        if(cell(data, p2d_world_hash(tx, ty), t_exit) || t_exit >= ray->max_distance) {
+            break;
+        }
+
+        if(t_max_x < t_max_y) {
+            tx += step_x;
+            t_max_x += t_delta_x;
+        }
+        else {
+            ty += step_y;
+            t_max_y += t_delta_y;
+        }
+    }
+}
+
+static bool _p2d_ray_make(const char *caller, vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, struct p2d_ray *ray) {
+    float length = sqrtf(direction.x * direction.x + direction.y * direction.y);
+    if(!(length > 0.0f) || !(max_distance >= 0.0f) || max_distance > FLT_MAX) {
+        if(caller) {
+            p2d_logf(P2D_LOG_ERROR, "%s: direction must not be zero, and max_distance must be finite and not negative.\n", caller);
+        }
+        return false;
+    }
+
+    *ray = (struct p2d_ray){
+        .origin = origin,
+        .direction = {{direction.x / length, direction.y / length}},
+        .max_distance = max_distance,
+        .mask = mask
+    };
+    return true;
+}
+
+//
+// QUERIES
+//
+
+bool p2d_raycast(vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, struct p2d_raycast_hit *hit) {
+    struct p2d_ray ray;
+    if(!_p2d_ray_make("p2d_raycast", origin, direction, max_distance, mask, &ray)) {
+        return false;
+    }
+
+    if(!_p2d_query_begin()) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_raycast: out of memory.\n");
+        return false;
+    }
+
+    struct p2d_ray_walk walk = {.ray = &ray, .closest = true};
+    _p2d_ray_cells(&ray, _p2d_ray_walk_cell, &walk);
+
+    if(walk.found && hit) {
+        *hit = walk.best;
+    }
+    return walk.found;
+}
+
+static int _p2d_compare_hits(const void *a, const void *b) {
+    const struct p2d_raycast_hit *ha = a;
+    const struct p2d_raycast_hit *hb = b;
+    if(ha->distance != hb->distance) {
+        return (ha->distance > hb->distance) - (ha->distance < hb->distance);
+    }
+    return (ha->handle > hb->handle) - (ha->handle < hb->handle);
+}
+
+int p2d_raycast_all(vec2_t origin, vec2_t direction, float max_distance, uint16_t mask, p2d_raycast_fn callback, void *user_data) {
+    struct p2d_ray ray;
+    if(!callback || !_p2d_ray_make("p2d_raycast_all", origin, direction, max_distance, mask, &ray)) {
+        return 0;
+    }
+
+    if(!_p2d_query_begin()) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_raycast_all: out of memory.\n");
+        return 0;
+    }
+
+    struct p2d_query_store *q = &p2d_queries;
+    q->hit_count = 0;
+
+    struct p2d_ray_walk walk = {.ray = &ray, .closest = false};
+    _p2d_ray_cells(&ray, _p2d_ray_walk_cell, &walk);
+
+    qsort(q->hits, (size_t)q->hit_count, sizeof(*q->hits), _p2d_compare_hits);
+
+    // the callback may query again, which reuses the hit list
+    int count = q->hit_count;
+    int reported = 0;
+    for(int i = 0; i < count; i++) {
+        struct p2d_raycast_hit hit = q->hits[i];
+        reported++;
+        if(!callback(&hit, user_data)) {
+            break;
+        }
+    }
+    return reported;
+}
+
+//
+// BATCHES
+//
+
+// a batch ray, keyed by the tile it starts in and the way it points
+struct p2d_ray_entry {
+    struct p2d_ray ray;
+    int tile_x;
+    int tile_y;
+    int octant;
+    int index; // into the caller's arrays
+};
+
+// one ray's cell, with its bodies sorted by shape into blocks for the kernels
+struct p2d_ray_block {
+    const struct p2d_ray *ray;
+
+    int circles[P2D_RAY_BLOCK];
+    int circle_count;
+    int boxes[P2D_RAY_BLOCK];
+    int box_count;
+
+    int best; // body index, -1 for none yet
+    float distance;
+    vec2_t normal;
+};
+
+struct p2d_ray_batch_job {
+    struct p2d_raycast_hit *hits;
+    int hit_counts[P2D_MAX_THREADS];
+};
+
+// every body's shape in the form the kernels want, rotation already applied
+static void _p2d_ray_shapes_range(void *data, int begin, int end, int thread) {
+    (void)data;
+    (void)thread;
+
+    for(int i = begin; i < end; i++) {
+        struct p2d_ray_shape *shape = &p2d_queries.shapes[i];
+        struct p2d_object proxy;
+        p2d_body_proxy(i, &proxy);
+
+        if(proxy.type == P2D_OBJECT_CIRCLE) {
+            *shape = (struct p2d_ray_shape){.x = proxy.x, .y = proxy.y, .w = proxy.circle.radius, .circle = true};
+            continue;
+        }
+
+        // a zero sized box is left with no axes, which the kernel never reports as hit
+        float w = proxy.rectangle.width;
+        float h = proxy.rectangle.height;
+        struct p2d_obb_verts verts = p2d_obb_to_verts(p2d_get_obb(&proxy));
+        *shape = (struct p2d_ray_shape){.x = verts.verts[0].x, .y = verts.verts[0].y};
+        if(w > 0.0f && h > 0.0f) {
+            shape->ux = (verts.verts[1].x - verts.verts[0].x) / w;
+            shape->uy = (verts.verts[1].y - verts.verts[0].y) / w;
+            shape->vx = (verts.verts[3].x - verts.verts[0].x) / h;
+            shape->vy = (verts.verts[3].y - verts.verts[0].y) / h;
+            shape->w = w;
+            shape->h = h;
+        }
+    }
+}
+
+/*
+    The kernels copy a block's shapes out of the table first, then test them in a plain loop with
+    selects instead of early outs, so every body in the block costs the same. Entries past count
+    are never read.
+*/
+static void _p2d_ray_circle_block(struct p2d_ray_block *block) {
+    const struct p2d_ray *ray = block->ray;
+    const struct p2d_ray_shape *shapes = p2d_queries.shapes;
+    int count = block->circle_count;
+
+    float cx[P2D_RAY_BLOCK], cy[P2D_RAY_BLOCK], r[P2D_RAY_BLOCK], t[P2D_RAY_BLOCK];
+    for(int k = 0; k < count; k++) {
+        const struct p2d_ray_shape *shape = &shapes[block->circles[k]];
+        cx[k] = shape->x;
+        cy[k] = shape->y;
+        r[k] = shape->w;
+    }
+
+    for(int k = 0; k < count; k++) {
+        float mx = ray->origin.x - cx[k];
+        float my = ray->origin.y - cy[k];
+        float b = mx * ray->direction.x + my * ray->direction.y;
+        float c = mx * mx + my * my - r[k] * r[k];
+        float disc = b * b - c;
+        float enter = -b - sqrtf(fmaxf(disc, 0.0f));
+        t[k] = (c > 0.0f && b <= 0.0f && disc >= 0.0f) ? enter : FLT_MAX;
+    }
+
+    for(int k = 0; k < count; k++) {
+        if(t[k] < block->distance) {
+            block->best = block->circles[k];
+            block->distance = t[k];
+            block->normal = (vec2_t){{
+                (ray->origin.x + ray->direction.x * t[k] - cx[k]) / r[k],
+                (ray->origin.y + ray->direction.y * t[k] - cy[k]) / r[k]
+            }};
+        }
+    }
+    block->circle_count = 0;
+}
+
+static void _p2d_ray_box_block(struct p2d_ray_block *block) {
+    const struct p2d_ray *ray = block->ray;
+    const struct p2d_ray_shape *shapes = p2d_queries.shapes;
+    int count = block->box_count;
+
+    float px[P2D_RAY_BLOCK], py[P2D_RAY_BLOCK], ux[P2D_RAY_BLOCK], uy[P2D_RAY_BLOCK];
+    float vx[P2D_RAY_BLOCK], vy[P2D_RAY_BLOCK], w[P2D_RAY_BLOCK], h[P2D_RAY_BLOCK];
+    float t[P2D_RAY_BLOCK], nx[P2D_RAY_BLOCK], ny[P2D_RAY_BLOCK];
+    for(int k = 0; k < count; k++) {
+        const struct p2d_ray_shape *shape = &shapes[block->boxes[k]];
+        px[k] = ray->origin.x - shape->x;
+        py[k] = ray->origin.y - shape->y;
+        ux[k] = shape->ux;
+        uy[k] = shape->uy;
+        vx[k] = shape->vx;
+        vy[k] = shape->vy;
+        w[k] = shape->w;
+        h[k] = shape->h;
+    }
+
+    // slabs in box space, an axis the ray runs along is all or nothing depending on where it starts
+    for(int k = 0; k < count; k++) {
+        float lu = px[k] * ux[k] + py[k] * uy[k];
+        float lv = px[k] * vx[k] + py[k] * vy[k];
+        float du = ray->direction.x * ux[k] + ray->direction.y * uy[k];
+        float dv = ray->direction.x * vx[k] + ray->direction.y * vy[k];
+
+        bool slab_u = du != 0.0f;
+        bool slab_v = dv != 0.0f;
+        float iu = 1.0f / (slab_u ? du : 1.0f);
+        float iv = 1.0f / (slab_v ? dv : 1.0f);
+        bool in_u = lu >= 0.0f && lu <= w[k];
+        bool in_v = lv >= 0.0f && lv <= h[k];
+
+        float u0 = -lu * iu, u1 = (w[k] - lu) * iu;
+        float v0 = -lv * iv, v1 = (h[k] - lv) * iv;
+        float u_enter = slab_u ? fminf(u0, u1) : (in_u ? -FLT_MAX : FLT_MAX);
+        float u_exit = slab_u ? fmaxf(u0, u1) : (in_u ? FLT_MAX : -FLT_MAX);
+        float v_enter = slab_v ? fminf(v0, v1) : (in_v ? -FLT_MAX : FLT_MAX);
+        float v_exit = slab_v ? fmaxf(v0, v1) : (in_v ? FLT_MAX : -FLT_MAX);
+
+        float enter = fmaxf(u_enter, v_enter);
+        float exit = fminf(u_exit, v_exit);
+        t[k] = (enter >= 0.0f && enter <= exit) ? enter : FLT_MAX;
+
+        // facing back along the ray, on the axis it came in through last
+        bool through_u = u_enter >= v_enter;
+        float su = du > 0.0f ? -1.0f : 1.0f;
+        float sv = dv > 0.0f ? -1.0f : 1.0f;
+        nx[k] = through_u ? ux[k] * su : vx[k] * sv;
+        ny[k] = through_u ? uy[k] * su : vy[k] * sv;
+    }
+
+    for(int k = 0; k < count; k++) {
+        if(t[k] < block->distance) {
+            block->best = block->boxes[k];
+            block->distance = t[k];
+            block->normal = (vec2_t){{nx[k], ny[k]}};
+        }
+    }
+    block->box_count = 0;
+}
+
+static void _p2d_ray_gather(struct p2d_ray_block *block, struct p2d_world_node *node) {
+    const struct p2d_ray *ray = block->ray;
+
+    // no stamps here, a body spanning cells along the ray is only tested again, which can't change the closest hit
+    for(; node; node = node->next) {
+        int i = p2d_body_index(node->handle);
+        if(i < 0 || (p2d_bodies.flags[i] & P2D_BODY_TRIGGER) || !(p2d_bodies.mask[i] & ray->mask)) {
+            continue;
+        }
+
+        if(p2d_queries.shapes[i].circle) {
+            block->circles[block->circle_count++] = i;
+            if(block->circle_count == P2D_RAY_BLOCK) {
+                _p2d_ray_circle_block(block);
+            }
+        }
+        else {
+            block->boxes[block->box_count++] = i;
+            if(block->box_count == P2D_RAY_BLOCK) {
+                _p2d_ray_box_block(block);
+            }
+        }
+    }
+}
+
+static bool _p2d_ray_batch_cell(void *data, int hash, float t_exit) {
+    struct p2d_ray_block *block = data;
+    _p2d_ray_gather(block, p2d_world[hash]);
+    _p2d_ray_gather(block, p2d_world_resting[hash]);
+    _p2d_ray_gather(block, p2d_broadphase.statics[hash]);
+    _p2d_ray_circle_block(block);
+    _p2d_ray_box_block(block);
+
+    return block->best >= 0 && block->distance <= t_exit;
+}
+
+// a run of neighbouring rays, which mostly walk the same buckets
+static void _p2d_ray_batch_range(void *data, int begin, int end, int thread) {
+    struct p2d_ray_batch_job *job = data;
+
+    for(int e = begin; e < end; e++) {
+        const struct p2d_ray_entry *entry = &p2d_queries.batch[e];
+        const struct p2d_ray *ray = &entry->ray;
+
+        struct p2d_ray_block block = {.ray = ray, .best = -1, .distance = FLT_MAX};
+        _p2d_ray_cells(ray, _p2d_ray_batch_cell, &block);
+
+        if(block.best < 0 || block.distance > ray->max_distance) {
+            continue;
+        }
+
+        job->hits[entry->index] = (struct p2d_raycast_hit){
+            .object = p2d_objects[block.best],
+            .handle = p2d_bodies.handle[block.best],
+            .point = {{ray->origin.x + ray->direction.x * block.distance, ray->origin.y + ray->direction.y * block.distance}},
+            .normal = block.normal,
+            .distance = block.distance
+        };
+        job->hit_counts[thread]++;
+    }
+}
+
+static int _p2d_compare_entries(const void *a, const void *b) {
+    const struct p2d_ray_entry *ea = a;
+    const struct p2d_ray_entry *eb = b;
+    if(ea->tile_y != eb->tile_y) {
+        return (ea->tile_y > eb->tile_y) - (ea->tile_y < eb->tile_y);
+    }
+    if(ea->tile_x != eb->tile_x) {
+        return (ea->tile_x > eb->tile_x) - (ea->tile_x < eb->tile_x);
+    }
+    if(ea->octant != eb->octant) {
+        return ea->octant - eb->octant;
+    }
+    return ea->index - eb->index;
+}
+
+int p2d_raycast_batch(const struct p2d_ray_query *rays, int count, struct p2d_raycast_hit *hits) {
+    struct p2d_query_store *q = &p2d_queries;
+    if(count <= 0 || !rays || !hits) {
+        return 0;
+    }
+
+    if(!p2d_grow((void **)&q->batch, &q->batch_capacity, count, sizeof(*q->batch)) ||
+       !p2d_grow((void **)&q->shapes, &q->shape_capacity, p2d_bodies.count, sizeof(*q->shapes))) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_raycast_batch: out of memory.\n");
+        return 0;
+    }
+
+    float size = (float)p2d_state.p2d_cell_size;
+    int entries = 0;
+    int invalid = 0;
+    for(int r = 0; r < count; r++) {
+        hits[r] = (struct p2d_raycast_hit){.handle = -1};
+
+        struct p2d_ray_entry *entry = &q->batch[entries];
+        if(!_p2d_ray_make(NULL, rays[r].origin, rays[r].direction, rays[r].max_distance, rays[r].mask, &entry->ray)) {
+            invalid++;
+            continue;
+        }
+
+        vec2_t d = entry->ray.direction;
+        entry->tile_x = (int)floorf(entry->ray.origin.x / size);
+        entry->tile_y = (int)floorf(entry->ray.origin.y / size);
+        entry->octant = (d.x < 0.0f) | (d.y < 0.0f) << 1 | (fabsf(d.x) < fabsf(d.y)) << 2;
+        entry->index = r;
+        entries++;
+    }
+
+    if(invalid > 0) {
+        p2d_logf(P2D_LOG_WARN, "p2d_raycast_batch: skipped %d rays with a zero direction or a bad max_distance.\n", invalid);
+    }
+
+    // rays starting near each other and pointing the same way end up in the same job
+    qsort(q->batch, (size_t)entries, sizeof(*q->batch), _p2d_compare_entries);
+
+    p2d_parallel_for(p2d_bodies.count, P2D_JOB_GRAIN, _p2d_ray_shapes_range, NULL);
+
+    struct p2d_ray_batch_job job = {.hits = hits};
+    p2d_parallel_for(entries, P2D_RAY_GRAIN, _p2d_ray_batch_range, &job);
+
+    int hit_count = 0;
+    for(int t = 0; t < P2D_MAX_THREADS; t++) {
+        hit_count += job.hit_counts[t];
+    }
+    return hit_count;
+}
+
+void p2d_query_shutdown(void) {
+    p2d_free(p2d_queries.stamps, (size_t)p2d_queries.stamp_capacity * sizeof(*p2d_queries.stamps));
+    p2d_free(p2d_queries.hits, (size_t)p2d_queries.hit_capacity * sizeof(*p2d_queries.hits));
+    p2d_free(p2d_queries.shapes, (size_t)p2d_queries.shape_capacity * sizeof(*p2d_queries.shapes));
+    p2d_free(p2d_queries.batch, (size_t)p2d_queries.batch_capacity * sizeof(*p2d_queries.batch));
+    memset(&p2d_queries, 0, sizeof(p2d_queries));
+}
@@ -0,0 +1,518 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <math.h>
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/context.h"
+#include "p2d/world.h"
+#include "p2d/memory.h"
+#include "p2d/region.h"
+#include "p2d/helpers.h"
+#include "internal.h"
+
+static int _p2d_region_hash(int cell_x, int cell_y) {
+    unsigned int hash = ((unsigned int)cell_x * 73856093u) ^ ((unsigned int)cell_y * 19349663u);
+    return (int)(hash % P2D_REGION_BUCKETS);
+}
+
+static float _p2d_region_cell_size(void) {
+    return (float)(p2d_state.p2d_cell_size * P2D_REGION_CELL_SCALE);
+}
+
+//
+// REGION MANAGEMENT
+//
+
+int p2d_add_region(struct p2d_aabb bounds) {
+    int region = -1;
+    for(int i = 0; i < p2d_regions.capacity; i++) {
+        if(!p2d_regions.list[i].in_use) {
+            region = i;
+            break;
+        }
+    }
+
+    if(region == -1) {
+        int capacity = p2d_regions.capacity ? p2d_regions.capacity * 2 : 8;
+        // the new slots come back zeroed, so not in use
+        struct p2d_region *grown = p2d_realloc(p2d_regions.list, sizeof(struct p2d_region) * (size_t)p2d_regions.capacity,
+                                               sizeof(struct p2d_region) * (size_t)capacity);
+        if(!grown) {
+            p2d_logf(P2D_LOG_ERROR, "p2d_add_region: failed to allocate memory.\n");
+            return -1;
+        }
+
+        region = p2d_regions.capacity;
+        p2d_regions.list = grown;
+        p2d_regions.capacity = capacity;
+    }
+
+    p2d_regions.list[region].bounds = bounds;
+    p2d_regions.list[region].in_use = true;
+    p2d_regions.list[region].moved = true;
+    p2d_regions.index_dirty = true;
+
+    return region;
+}
+
+static bool _p2d_region_valid(int region) {
+    return region >= 0 && region < p2d_regions.capacity && p2d_regions.list[region].in_use;
+}
+
+bool p2d_move_region(int region, struct p2d_aabb bounds) {
+    if(!_p2d_region_valid(region)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_move_region: invalid region %d.\n", region);
+        return false;
+    }
+
+    p2d_regions.list[region].bounds = bounds;
+    p2d_regions.list[region].moved = true;
+    p2d_regions.index_dirty = true;
+    return true;
+}
+
+bool p2d_get_region(int region, struct p2d_aabb *out_bounds) {
+    if(!_p2d_region_valid(region) || !out_bounds) {
+        return false;
+    }
+
+    *out_bounds = p2d_regions.list[region].bounds;
+    return true;
+}
+
+bool p2d_remove_region(int region) {
+    if(!_p2d_region_valid(region)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_remove_region: invalid region %d.\n", region);
+        return false;
+    }
+
+    p2d_regions.list[region].in_use = false;
+    p2d_regions.index_dirty = true;
+    return true;
+}
+
+void p2d_remove_all_regions(void) {
+    p2d_free(p2d_regions.list, (size_t)p2d_regions.capacity * sizeof(struct p2d_region));
+    p2d_regions.list = NULL;
+    p2d_regions.capacity = 0;
+
+    for(int i = 0; i < P2D_REGION_BUCKETS; i++) {
+        p2d_free(p2d_regions.index[i].regions, (size_t)p2d_regions.index[i].capacity * sizeof(int));
+        p2d_regions.index[i] = (struct p2d_region_bucket){0};
+    }
+    p2d_regions.index_dirty = false;
+}
+
+//
+// REGION INDEX
+//
+
+static bool _p2d_region_bucket_add(struct p2d_region_bucket *bucket, int region) {
+    // a region covering several cells that hash together only needs listing once
+    if(bucket->count > 0 && bucket->regions[bucket->count - 1] == region) {
+        return true;
+    }
+
+    if(bucket->count >= bucket->capacity) {
+        int capacity = bucket->capacity ? bucket->capacity * 2 : 4;
+        int *grown = p2d_realloc(bucket->regions, sizeof(int) * (size_t)bucket->capacity, sizeof(int) * (size_t)capacity);
+        if(!grown) {
+            return false;
+        }
+        bucket->regions = grown;
+        bucket->capacity = capacity;
+    }
+
+    bucket->regions[bucket->count++] = region;
+    return true;
+}
+
+// leaves the index dirty if a bucket couldn't grow, lookups then go through the list instead
+static bool _p2d_rebuild_region_index(void) {
+    for(int i = 0; i < P2D_REGION_BUCKETS; i++) {
+        p2d_regions.index[i].count = 0;
+    }
+
+    float cell = _p2d_region_cell_size();
+
+    for(int r = 0; r < p2d_regions.capacity; r++) {
+        if(!p2d_regions.list[r].in_use) {
+            continue;
+        }
+
+        struct p2d_aabb b = p2d_regions.list[r].bounds;
+        int start_x = (int)floorf(b.x / cell);
+        int start_y = (int)floorf(b.y / cell);
+        int end_x = (int)floorf((b.x + b.w) / cell);
+        int end_y = (int)floorf((b.y + b.h) / cell);
+
+        for(int cx = start_x; cx <= end_x; cx++) {
+            for(int cy = start_y; cy <= end_y; cy++) {
+                if(!_p2d_region_bucket_add(&p2d_regions.index[_p2d_region_hash(cx, cy)], r)) {
+                    p2d_logf(P2D_LOG_ERROR, "_p2d_rebuild_region_index: failed to allocate memory.\n");
+                    return false;
+                }
+            }
+        }
+    }
+
+    p2d_regions.index_dirty = false;
+    return true;
+}
+
+bool p2d_aabb_in_any_region(struct p2d_aabb aabb) {
+    if(p2d_regions.index_dirty && !_p2d_rebuild_region_index()) {
+        for(int r = 0; r < p2d_regions.capacity; r++) {
+            if(p2d_regions.list[r].in_use && p2d_aabbs_intersect(p2d_regions.list[r].bounds, aabb)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    float cell = _p2d_region_cell_size();
+    int start_x = (int)floorf(aabb.x / cell);
+    int start_y = (int)floorf(aabb.y / cell);
+    int end_x = (int)floorf((aabb.x + aabb.w) / cell);
+    int end_y = (int)floorf((aabb.y + aabb.h) / cell);
+
+    for(int cx = start_x; cx <= end_x; cx++) {
+        for(int cy = start_y; cy <= end_y; cy++) {
+            struct p2d_region_bucket *bucket = &p2d_regions.index[_p2d_region_hash(cx, cy)];
+
+            for(int i = 0; i < bucket->count; i++) {
+                if(p2d_aabbs_intersect(p2d_regions.list[bucket->regions[i]].bounds, aabb)) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+//
+// LEVEL OF DETAIL
+//
+
+int p2d_lod_period(int tier) {
+    int period = 1;
+    for(int i = 0; i < tier; i++) {
+        period *= p2d_state.p2d_lod_rate;
+    }
+    return period;
+}
+
+// distance from the regions a tier reaches out to
+static float _p2d_lod_reach(void) {
+    if(p2d_state.p2d_lod_tiers <= 0) {
+        return 0.0f;
+    }
+    return p2d_state.p2d_lod_distance * (float)p2d_state.p2d_lod_tiers;
+}
+
+// -1 means out of reach of every tier
+static int _p2d_lod_tier(struct p2d_aabb bounds) {
+    if(p2d_aabb_in_any_region(bounds)) {
+        return 0;
+    }
+
+    for(int tier = 1; tier <= p2d_state.p2d_lod_tiers; tier++) {
+        float pad = p2d_state.p2d_lod_distance * (float)tier;
+        struct p2d_aabb grown = {
+            .x = bounds.x - pad,
+            .y = bounds.y - pad,
+            .w = bounds.w + pad * 2,
+            .h = bounds.h + pad * 2
+        };
+
+        if(p2d_aabb_in_any_region(grown)) {
+            return tier;
+        }
+    }
+
+    return -1;
+}
+
+// tiers are offset from each other so their steps don't all land on the same frame
+static bool _p2d_lod_due(int tier) {
+    int period = p2d_lod_period(tier);
+    if(period <= 1) {
+        return true;
+    }
+    return (p2d_state.p2d_step_count + (unsigned int)tier) % (unsigned int)period == 0;
+}
+
+/*
+    A parked object sits out this step, but everything else can still run into it.
+    Zero inverse mass makes the solver and joints treat it as immovable.
+*/
+static void _p2d_park_object(struct p2d_object *object) {
+    object->parked = true;
+    object->inv_mass = 0.0f;
+    object->inv_inertia = 0.0f;
+    p2d_state.p2d_parked_count++;
+}
+
+void p2d_unpark_object(struct p2d_object *object) {
+    if(!object || !object->parked) {
+        return;
+    }
+
+    object->parked = false;
+    object->inv_mass = p2d_inv_mass(object);
+    object->inv_inertia = p2d_inv_inertia(object);
+    p2d_state.p2d_parked_count--;
+}
+
+static void _p2d_reset_lod(void) {
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        struct p2d_object *object = p2d_objects[i];
+        p2d_unpark_object(object);
+        object->lod = 0;
+    }
+}
+
+//
+// CULLED TABLE
+//
+
+static int _p2d_culled_hash(float x, float y) {
+    float cell = (float)p2d_state.p2d_cell_size;
+    return p2d_world_hash((int)floorf(x / cell), (int)floorf(y / cell));
+}
+
+static void _p2d_cull_object(struct p2d_object *object, struct p2d_aabb bounds) {
+    // over the memory budget, the object just stays simulated
+    struct p2d_world_node *node = p2d_alloc(sizeof(struct p2d_world_node));
+    if(!node) {
+        return;
+    }
+
+    int hash = _p2d_culled_hash(bounds.x + bounds.w * 0.5f, bounds.y + bounds.h * 0.5f);
+    node->object = object;
+    node->next = p2d_regions.culled[hash];
+    p2d_regions.culled[hash] = node;
+
+    object->culled = true;
+    object->cull_hash = hash;
+
+    /*
+        Culled where it stands now, so a move made before this isn't taken for one made after
+        (which releases it, see p2d_bodies_gather). Statics are left to gather, which teleports them.
+    */
+    int index = p2d_body_index(object->handle);
+    if(index >= 0 && !object->is_static) {
+        p2d_body_store_pose(index, object);
+    }
+    p2d_regions.culled_max_extent = fmaxf(p2d_regions.culled_max_extent, fmaxf(bounds.w, bounds.h) * 0.5f);
+    p2d_state.p2d_culled_count++;
+
+    // sleeping objects move between the resting table and this one
+    if(object->sleeping) {
+        p2d_world_mark_resting_dirty();
+    }
+}
+
+void p2d_cull_object(struct p2d_object *object) {
+    if(!object || object->culled) {
+        return;
+    }
+    _p2d_cull_object(object, p2d_get_loose_aabb(object));
+}
+
+void p2d_release_culled_object(struct p2d_object *object) {
+    if(!object || !object->culled) {
+        return;
+    }
+
+    struct p2d_world_node **link = &p2d_regions.culled[object->cull_hash];
+    while(*link) {
+        struct p2d_world_node *node = *link;
+        if(node->object == object) {
+            *link = node->next;
+            p2d_free(node, sizeof(struct p2d_world_node));
+            break;
+        }
+        link = &node->next;
+    }
+
+    object->culled = false;
+    p2d_state.p2d_culled_count--;
+    if(p2d_state.p2d_culled_count == 0) {
+        p2d_regions.culled_max_extent = 0.0f;
+    }
+
+    if(object->sleeping) {
+        p2d_world_mark_resting_dirty();
+    }
+}
+
+void p2d_release_all_culled_objects(void) {
+    for(int i = 0; p2d_regions.culled && i < p2d_state.p2d_bucket_count; i++) {
+        struct p2d_world_node *node = p2d_regions.culled[i];
+        while(node != NULL) {
+            struct p2d_world_node *next = node->next;
+            node->object->culled = false;
+            p2d_free(node, sizeof(struct p2d_world_node));
+            node = next;
+        }
+        p2d_regions.culled[i] = NULL;
+    }
+
+    p2d_state.p2d_culled_count = 0;
+    p2d_regions.culled_max_extent = 0.0f;
+    p2d_world_mark_resting_dirty();
+}
+
+bool p2d_rehash_culled_objects(int old_buckets) {
+    // pull every node out while the old hash still applies
+    struct p2d_world_node *pending = NULL;
+    for(int i = 0; p2d_regions.culled && i < old_buckets; i++) {
+        struct p2d_world_node *node = p2d_regions.culled[i];
+        while(node != NULL) {
+            struct p2d_world_node *next = node->next;
+            node->next = pending;
+            pending = node;
+            node = next;
+        }
+        p2d_regions.culled[i] = NULL;
+    }
+
+    size_t old_size = (size_t)old_buckets * sizeof(*p2d_regions.culled);
+    size_t new_size = (size_t)p2d_state.p2d_bucket_count * sizeof(*p2d_regions.culled);
+    struct p2d_world_node **table = p2d_realloc(p2d_regions.culled, old_size, new_size);
+    if(!table) {
+        // can't keep them culled without a table, let them simulate again
+        while(pending != NULL) {
+            struct p2d_world_node *next = pending->next;
+            pending->object->culled = false;
+            p2d_state.p2d_culled_count--;
+            p2d_free(pending, sizeof(struct p2d_world_node));
+            pending = next;
+        }
+        return false;
+    }
+    p2d_regions.culled = table;
+
+    // culled objects haven't moved, so their loose bounds are the ones they were culled with
+    while(pending != NULL) {
+        struct p2d_world_node *next = pending->next;
+        struct p2d_aabb bounds = p2d_get_loose_aabb(pending->object);
+        int hash = _p2d_culled_hash(bounds.x + bounds.w * 0.5f, bounds.y + bounds.h * 0.5f);
+
+        pending->next = p2d_regions.culled[hash];
+        p2d_regions.culled[hash] = pending;
+        pending->object->cull_hash = hash;
+        pending = next;
+    }
+
+    return true;
+}
+
+void p2d_culled_shutdown(void) {
+    p2d_release_all_culled_objects();
+    p2d_free(p2d_regions.culled, (size_t)p2d_state.p2d_bucket_count * sizeof(*p2d_regions.culled));
+    p2d_regions.culled = NULL;
+}
+
+// release every culled object overlapping a region that moved since last step
+static void _p2d_release_under_region(struct p2d_aabb bounds) {
+    float cell = (float)p2d_state.p2d_cell_size;
+    float pad = p2d_regions.culled_max_extent + _p2d_lod_reach();
+
+    int start_x = (int)floorf((bounds.x - pad) / cell);
+    int start_y = (int)floorf((bounds.y - pad) / cell);
+    int end_x = (int)floorf((bounds.x + bounds.w + pad) / cell);
+    int end_y = (int)floorf((bounds.y + bounds.h + pad) / cell);
+
+    for(int tx = start_x; tx <= end_x; tx++) {
+        for(int ty = start_y; ty <= end_y; ty++) {
+            struct p2d_world_node *node = p2d_regions.culled[p2d_world_hash(tx, ty)];
+
+            while(node != NULL) {
+                struct p2d_world_node *next = node->next;
+                struct p2d_object *object = node->object;
+
+                if(_p2d_lod_tier(p2d_get_loose_aabb(object)) >= 0) {
+                    p2d_release_culled_object(object);
+                }
+
+                node = next;
+            }
+        }
+    }
+}
+
+void p2d_update_regions(void) {
+    if(!p2d_state.p2d_region_sleeping) {
+        if(p2d_state.p2d_culled_count > 0) {
+            p2d_release_all_culled_objects();
+        }
+        if(p2d_regions.lod_was_on) {
+            _p2d_reset_lod();
+            p2d_regions.lod_was_on = false;
+        }
+        return;
+    }
+    p2d_regions.lod_was_on = true;
+
+    if(p2d_regions.index_dirty) {
+        _p2d_rebuild_region_index();
+    }
+
+    // tiers reaching further than before may cover culled objects, even for regions that didn't move
+    if(_p2d_lod_reach() != p2d_regions.last_lod_reach) {
+        p2d_regions.last_lod_reach = _p2d_lod_reach();
+        for(int r = 0; r < p2d_regions.capacity; r++) {
+            p2d_regions.list[r].moved = true;
+        }
+    }
+
+    /*
+        Culled objects never move, so only a region that moved can have reached new ones
+    */
+    for(int r = 0; r < p2d_regions.capacity; r++) {
+        if(!p2d_regions.list[r].in_use || !p2d_regions.list[r].moved) {
+            continue;
+        }
+
+        if(p2d_state.p2d_culled_count > 0) {
+            _p2d_release_under_region(p2d_regions.list[r].bounds);
+        }
+        p2d_regions.list[r].moved = false;
+    }
+
+    /*
+        Cull simulated objects that are out of reach of every region,
+        and sort the rest into level of detail tiers
+    */
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        struct p2d_object *object = p2d_objects[i];
+        if(object->culled) {
+            continue;
+        }
+
+        p2d_unpark_object(object);
+
+        struct p2d_aabb bounds = p2d_get_loose_aabb(object);
+        int tier = _p2d_lod_tier(bounds);
+        if(tier < 0) {
+            object->lod = 0;
+            _p2d_cull_object(object, bounds);
+            continue;
+        }
+
+        object->lod = tier;
+        if(tier > 0 && !object->is_static && !object->sleeping && !_p2d_lod_due(tier)) {
+            _p2d_park_object(object);
+        }
+    }
+}
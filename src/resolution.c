@@ -6,9 +6,11 @@
 */
 
 #include "p2d/log.h"
+#include "p2d/context.h"
 #include "p2d/helpers.h"
 #include "p2d/contacts.h"
 #include "p2d/resolution.h"
+#include "internal.h"
 
 /*
     TODO: i dont think this _actually_ works, it dampens but it doesnt scale the decrease, its just like
@@ -67,6 +69,10 @@ void p2d_object_step(struct p2d_object *object, float delta_time, int iterations
         return;
     }
 
+    if(object->sleeping || object->culled) {
+        return;
+    }
+
     // account for substepping
     delta_time /= (float)iterations;
 
@@ -367,7 +373,7 @@ void _p2d_rotational_friction_resolution(struct p2d_collision_manifold *manifold
         obj_b->vr += b_ang_vel_delta;
     }
 
-
+    manifold->impulse = j_list[0] + j_list[1];
 
 
     /*
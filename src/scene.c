@@ -0,0 +1,510 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/context.h"
+#include "p2d/world.h"
+#include "p2d/joint.h"
+#include "p2d/helpers.h"
+#include "p2d/scene.h"
+#include "internal.h"
+
+static uint64_t _p2d_scene_align(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+// lays the sections out after the header, returns the file size
+static uint64_t _p2d_scene_layout(struct p2d_scene_header *header) {
+    uint64_t offset = _p2d_scene_align(sizeof(*header));
+
+    header->bodies = offset;
+    offset = _p2d_scene_align(offset + (uint64_t)header->body_count * sizeof(struct p2d_scene_body));
+    header->joints = offset;
+    offset = _p2d_scene_align(offset + (uint64_t)header->joint_count * sizeof(struct p2d_scene_joint));
+    header->tile_starts = offset;
+    offset = _p2d_scene_align(offset + ((uint64_t)header->body_count + 1) * sizeof(uint32_t));
+    header->tiles = offset;
+    offset = _p2d_scene_align(offset + (uint64_t)header->tile_count * 2 * sizeof(int32_t));
+
+    return offset;
+}
+
+//
+// WRITING
+//
+
+struct p2d_scene_tiles {
+    int32_t *tiles;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+static bool _p2d_scene_push_tile(struct p2d_scene_tiles *list, int tile_x, int tile_y) {
+    if(list->count == list->capacity) {
+        uint32_t grown = list->capacity ? list->capacity * 2 : 1024;
+        int32_t *tiles = realloc(list->tiles, (size_t)grown * 2 * sizeof(*tiles));
+        if(!tiles) {
+            return false;
+        }
+        list->tiles = tiles;
+        list->capacity = grown;
+    }
+
+    list->tiles[list->count * 2] = tile_x;
+    list->tiles[list->count * 2 + 1] = tile_y;
+    list->count++;
+    return true;
+}
+
+// the same tiles p2d_for_each_tile_in_aabb() visits, as coordinates instead of hashes (those depend on the bucket count)
+static bool _p2d_scene_bake_tiles(struct p2d_object *object, struct p2d_scene_tiles *list) {
+    struct p2d_aabb aabb = p2d_get_aabb(object);
+    int cell_size = p2d_state.p2d_cell_size;
+
+    int start_tile_x = (int)floorf(aabb.x / (float)cell_size);
+    int start_tile_y = (int)floorf(aabb.y / (float)cell_size);
+    int end_tile_x = (int)floorf((aabb.x + aabb.w) / (float)cell_size);
+    int end_tile_y = (int)floorf((aabb.y + aabb.h) / (float)cell_size);
+
+    for(int tile_x = start_tile_x; tile_x <= end_tile_x; tile_x++) {
+        for(int tile_y = start_tile_y; tile_y <= end_tile_y; tile_y++) {
+            struct p2d_aabb tile = {
+                .x = (float)(tile_x * cell_size),
+                .y = (float)(tile_y * cell_size),
+                .w = (float)cell_size,
+                .h = (float)cell_size
+            };
+
+            if(_object_intersects_tile(object, tile) && !_p2d_scene_push_tile(list, tile_x, tile_y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static int32_t _p2d_scene_body_index(const struct p2d_object *objects, int count, const struct p2d_object *object) {
+    uintptr_t first = (uintptr_t)objects;
+    uintptr_t at = (uintptr_t)object;
+    if(!object || at < first || at >= first + (uintptr_t)count * sizeof(*objects) || (at - first) % sizeof(*objects) != 0) {
+        return -1;
+    }
+    return (int32_t)((at - first) / sizeof(*objects));
+}
+
+bool p2d_scene_write(const char *path, const struct p2d_object *objects, int count, const struct p2d_joint *joints, int joint_count, bool bake_statics) {
+    if(!path || count < 0 || joint_count < 0 || (count && !objects) || (joint_count && !joints)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_write: invalid arguments.\n");
+        return false;
+    }
+
+    struct p2d_scene_header header = {
+        .magic = P2D_SCENE_MAGIC,
+        .version = P2D_SCENE_VERSION,
+        .endian = P2D_SCENE_ENDIAN,
+        .body_count = (uint32_t)count,
+        .joint_count = (uint32_t)joint_count,
+        .cell_size = bake_statics ? p2d_state.p2d_cell_size : 0
+    };
+
+    bool ok = true;
+    unsigned char *image = NULL;
+    struct p2d_scene_tiles list = {0};
+
+    uint32_t *tile_starts = malloc(((size_t)count + 1) * sizeof(*tile_starts));
+    if(!tile_starts) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_write: out of memory.\n");
+        return false;
+    }
+
+    // static tiles first, they decide the size
+    for(int i = 0; i < count; i++) {
+        tile_starts[i] = list.count;
+
+        if(bake_statics && objects[i].is_static) {
+            struct p2d_object object = objects[i];
+            if(!_p2d_scene_bake_tiles(&object, &list)) {
+                p2d_logf(P2D_LOG_ERROR, "p2d_scene_write: out of memory.\n");
+                ok = false;
+                goto done;
+            }
+        }
+    }
+    tile_starts[count] = list.count;
+    header.tile_count = list.count;
+
+    header.size = _p2d_scene_layout(&header);
+    image = calloc(1, (size_t)header.size);
+    if(!image) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_write: out of memory.\n");
+        ok = false;
+        goto done;
+    }
+
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.tile_starts, tile_starts, ((size_t)count + 1) * sizeof(*tile_starts));
+    if(list.count) {
+        memcpy(image + header.tiles, list.tiles, (size_t)list.count * 2 * sizeof(*list.tiles));
+    }
+
+    struct p2d_scene_body *bodies = (struct p2d_scene_body *)(image + header.bodies);
+    for(int i = 0; i < count; i++) {
+        struct p2d_object object = objects[i];
+        p2d_object_compute_mass(&object);
+
+        bool rectangle = object.type == P2D_OBJECT_RECTANGLE;
+        bodies[i] = (struct p2d_scene_body){
+            .type = (uint32_t)object.type,
+            .flags = (object.is_static ? P2D_SCENE_BODY_STATIC : 0) | (object.is_trigger ? P2D_SCENE_BODY_TRIGGER : 0),
+            .mask = object.mask,
+            .x = object.x, .y = object.y, .rotation = object.rotation,
+            .vx = object.vx, .vy = object.vy, .vr = object.vr,
+            .width = rectangle ? object.rectangle.width : object.circle.radius,
+            .height = rectangle ? object.rectangle.height : object.circle.radius,
+            .density = object.density, .restitution = object.restitution,
+            .static_friction = object.static_friction, .dynamic_friction = object.dynamic_friction,
+            .area = object.area,
+            .mass = object.mass, .inv_mass = object.inv_mass,
+            .inertia = object.inertia, .inv_inertia = object.inv_inertia,
+            .width_meters = rectangle ? object.rectangle.width_meters : object.circle.radius_meters,
+            .height_meters = rectangle ? object.rectangle.height_meters : object.circle.radius_meters
+        };
+    }
+
+    struct p2d_scene_joint *records = (struct p2d_scene_joint *)(image + header.joints);
+    for(int j = 0; j < joint_count; j++) {
+        const struct p2d_joint *joint = &joints[j];
+
+        int32_t a = _p2d_scene_body_index(objects, count, joint->a);
+        int32_t b = joint->anchored_to_world ? -1 : _p2d_scene_body_index(objects, count, joint->b);
+        if(a < 0 || (!joint->anchored_to_world && b < 0)) {
+            p2d_logf(P2D_LOG_ERROR, "p2d_scene_write: joint %d references an object outside of the scene.\n", j);
+            ok = false;
+            goto done;
+        }
+
+        records[j] = (struct p2d_scene_joint){
+            .a = a,
+            .b = b,
+            .type = (uint32_t)joint->type,
+            .flags = (joint->anchored_to_world ? P2D_SCENE_JOINT_WORLD : 0) | (joint->disable_collisions ? P2D_SCENE_JOINT_NO_COLLIDE : 0),
+            .world_anchor_b = {joint->anchored_to_world ? joint->world_anchor_b.x : 0, joint->anchored_to_world ? joint->world_anchor_b.y : 0},
+            .local_anchor_a = {joint->local_anchor_a.x, joint->local_anchor_a.y},
+            .local_anchor_b = {joint->local_anchor_b.x, joint->local_anchor_b.y},
+            .bias_factor = joint->bias_factor,
+            .rest_length = joint->spring_joint.rest_length,
+            .spring_constant = joint->spring_joint.spring_constant
+        };
+    }
+
+    FILE *file = fopen(path, "wb");
+    if(!file) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_write: could not open %s.\n", path);
+        ok = false;
+        goto done;
+    }
+    ok = fwrite(image, 1, (size_t)header.size, file) == (size_t)header.size;
+    ok = fclose(file) == 0 && ok;
+    if(!ok) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_write: could not write %s.\n", path);
+    }
+
+done:
+    free(image);
+    free(list.tiles);
+    free(tile_starts);
+    return ok;
+}
+
+//
+// READING
+//
+
+static bool _p2d_scene_section_fits(uint64_t offset, uint64_t bytes, uint64_t size) {
+    return (offset & 7) == 0 && offset <= size && bytes <= size - offset;
+}
+
+bool p2d_scene_from_memory(const void *data, size_t size, struct p2d_scene *scene) {
+    if(!scene) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_from_memory: scene is NULL.\n");
+        return false;
+    }
+    memset(scene, 0, sizeof(*scene));
+
+    const struct p2d_scene_header *header = data;
+    if(!data || ((uintptr_t)data & 7) != 0 || size < sizeof(*header) || header->magic != P2D_SCENE_MAGIC) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_from_memory: not a scene.\n");
+        return false;
+    }
+    if(header->version != P2D_SCENE_VERSION || header->endian != P2D_SCENE_ENDIAN) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_from_memory: scene version %u (or byte order) is not supported.\n", header->version);
+        return false;
+    }
+
+    uint64_t bytes = header->size;
+    if(bytes > size || header->body_count > INT_MAX || header->joint_count > INT_MAX ||
+       !_p2d_scene_section_fits(header->bodies, (uint64_t)header->body_count * sizeof(struct p2d_scene_body), bytes) ||
+       !_p2d_scene_section_fits(header->joints, (uint64_t)header->joint_count * sizeof(struct p2d_scene_joint), bytes) ||
+       !_p2d_scene_section_fits(header->tile_starts, ((uint64_t)header->body_count + 1) * sizeof(uint32_t), bytes) ||
+       !_p2d_scene_section_fits(header->tiles, (uint64_t)header->tile_count * 2 * sizeof(int32_t), bytes)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_from_memory: scene is truncated.\n");
+        return false;
+    }
+
+    const unsigned char *base = data;
+    scene->header = header;
+    scene->bodies = (const struct p2d_scene_body *)(base + header->bodies);
+    scene->joints = (const struct p2d_scene_joint *)(base + header->joints);
+    scene->tile_starts = (const uint32_t *)(base + header->tile_starts);
+    scene->tiles = (const int32_t *)(base + header->tiles);
+    scene->body_count = (int)header->body_count;
+    scene->joint_count = (int)header->joint_count;
+
+    // the only thing the loader indexes with, everything else is copied as is
+    bool valid = scene->tile_starts[0] == 0 && scene->tile_starts[scene->body_count] == header->tile_count;
+    for(int i = 0; valid && i < scene->body_count; i++) {
+        valid = scene->tile_starts[i] <= scene->tile_starts[i + 1] &&
+                (scene->bodies[i].type == P2D_OBJECT_RECTANGLE || scene->bodies[i].type == P2D_OBJECT_CIRCLE);
+    }
+    for(int j = 0; valid && j < scene->joint_count; j++) {
+        const struct p2d_scene_joint *joint = &scene->joints[j];
+        bool world = (joint->flags & P2D_SCENE_JOINT_WORLD) != 0;
+        valid = joint->a >= 0 && joint->a < scene->body_count &&
+                (world || (joint->b >= 0 && joint->b < scene->body_count));
+    }
+    if(!valid) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_from_memory: scene is corrupt.\n");
+        memset(scene, 0, sizeof(*scene));
+        return false;
+    }
+
+    return true;
+}
+
+bool p2d_scene_open(const char *path, struct p2d_scene *scene) {
+    if(!path || !scene) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_open: path or scene is NULL.\n");
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_open: could not open %s.\n", path);
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    HANDLE mapping = NULL;
+    void *map = NULL;
+    if(GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if(mapping) {
+        map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if(!map) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_open: could not map %s.\n", path);
+        if(mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    size_t size = (size_t)file_size.QuadPart;
+#else
+    int file = open(path, O_RDONLY);
+    if(file < 0) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_open: could not open %s.\n", path);
+        return false;
+    }
+
+    // the mapping keeps the file, the descriptor can go right away
+    struct stat info;
+    void *map = MAP_FAILED;
+    if(fstat(file, &info) == 0 && info.st_size > 0) {
+        map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    if(map == MAP_FAILED) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_open: could not map %s.\n", path);
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+#endif
+
+    if(!p2d_scene_from_memory(map, size, scene)) {
+#ifdef _WIN32
+        UnmapViewOfFile(map);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(map, size);
+#endif
+        return false;
+    }
+
+    scene->map = map;
+    scene->map_size = size;
+#ifdef _WIN32
+    scene->file = file;
+    scene->mapping = mapping;
+#endif
+    return true;
+}
+
+void p2d_scene_close(struct p2d_scene *scene) {
+    if(!scene) {
+        return;
+    }
+
+    if(scene->map) {
+#ifdef _WIN32
+        UnmapViewOfFile(scene->map);
+        CloseHandle((HANDLE)scene->mapping);
+        CloseHandle((HANDLE)scene->file);
+#else
+        munmap(scene->map, scene->map_size);
+#endif
+    }
+    memset(scene, 0, sizeof(*scene));
+}
+
+//
+// LOADING
+//
+
+static void _p2d_scene_fill_object(const struct p2d_scene_body *record, struct p2d_object *object) {
+    *object = (struct p2d_object){
+        .type = (enum p2d_object_type)record->type,
+        .is_static = (record->flags & P2D_SCENE_BODY_STATIC) != 0,
+        .is_trigger = (record->flags & P2D_SCENE_BODY_TRIGGER) != 0,
+        .x = record->x, .y = record->y, .rotation = record->rotation,
+        .vx = record->vx, .vy = record->vy, .vr = record->vr,
+        .density = record->density, .restitution = record->restitution,
+        .static_friction = record->static_friction, .dynamic_friction = record->dynamic_friction,
+        .area = record->area,
+        .mass = record->mass, .inv_mass = record->inv_mass,
+        .inertia = record->inertia, .inv_inertia = record->inv_inertia,
+        .mask = (uint16_t)record->mask,
+        .handle = -1
+    };
+
+    if(object->type == P2D_OBJECT_RECTANGLE) {
+        object->rectangle.width = record->width;
+        object->rectangle.height = record->height;
+        object->rectangle.width_meters = record->width_meters;
+        object->rectangle.height_meters = record->height_meters;
+    }
+    else {
+        object->circle.radius = record->width;
+        object->circle.radius_meters = record->width_meters;
+    }
+}
+
+static void _p2d_scene_fill_joint(const struct p2d_scene_joint *record, struct p2d_object *objects, struct p2d_joint *joint) {
+    *joint = (struct p2d_joint){
+        .a = &objects[record->a],
+        .anchored_to_world = (record->flags & P2D_SCENE_JOINT_WORLD) != 0,
+        .type = (enum p2d_joint_type)record->type,
+        .local_anchor_a = {{record->local_anchor_a[0], record->local_anchor_a[1]}},
+        .local_anchor_b = {{record->local_anchor_b[0], record->local_anchor_b[1]}},
+        .bias_factor = record->bias_factor,
+        .disable_collisions = (record->flags & P2D_SCENE_JOINT_NO_COLLIDE) != 0,
+        .spring_joint = {.rest_length = record->rest_length, .spring_constant = record->spring_constant}
+    };
+
+    if(joint->anchored_to_world) {
+        joint->world_anchor_b = (vec2_t){{record->world_anchor_b[0], record->world_anchor_b[1]}};
+    }
+    else {
+        joint->b = &objects[record->b];
+    }
+}
+
+// true if some registered body is in the static table (or will be on the next rebuild)
+static bool _p2d_scene_world_has_statics(void) {
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        if((p2d_bodies.flags[i] & (P2D_BODY_STATIC | P2D_BODY_CULLED | P2D_BODY_INACTIVE)) == P2D_BODY_STATIC) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool p2d_scene_load(const struct p2d_scene *scene, struct p2d_object *objects, struct p2d_joint *joints) {
+    if(!scene || !scene->header || (scene->body_count && !objects) || (scene->joint_count && !joints)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_load: invalid arguments.\n");
+        return false;
+    }
+
+    struct p2d_body_store *s = &p2d_bodies;
+    int count = scene->body_count;
+
+    // everything is sized once up front (doubling, like one by one would), so nothing below can fail half way
+    int capacity = s->capacity > 0 ? s->capacity : P2D_DEFAULT_OBJECT_CAPACITY;
+    while(capacity < s->count + count) {
+        capacity *= 2;
+    }
+    if(!p2d_bodies_reserve(capacity) || !p2d_joints_reserve(p2d_state.p2d_joint_count + scene->joint_count)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_scene_load: %d objects and %d joints do not fit in the memory budget.\n", count, scene->joint_count);
+        return false;
+    }
+
+    // grow the tables now, growing on the next step would throw the baked tiles away
+    p2d_world_fit_bodies();
+
+    /*
+        Baked tiles can only go on top of a static table that is up to date (or empty),
+        otherwise the next rebuild redoes it all anyway.
+    */
+    bool baked = scene->header->cell_size != 0 && scene->header->cell_size == p2d_state.p2d_cell_size;
+    if(baked && !_p2d_scene_world_has_statics()) {
+        p2d_world_remove_all_statics();
+    }
+    baked = baked && !p2d_broadphase.statics_dirty;
+
+    int first = s->count;
+    for(int i = 0; i < count; i++) {
+        _p2d_scene_fill_object(&scene->bodies[i], &objects[i]);
+    }
+    p2d_body_attach_many(objects, count);
+    p2d_state.p2d_object_count += count;
+
+    if(baked) {
+        for(int i = 0; i < count; i++) {
+            for(uint32_t t = scene->tile_starts[i]; t < scene->tile_starts[i + 1]; t++) {
+                p2d_world_insert_static(first + i, scene->tiles[t * 2], scene->tiles[t * 2 + 1]);
+            }
+        }
+        p2d_broadphase.statics_dirty = false;
+    }
+
+    for(int j = 0; j < scene->joint_count; j++) {
+        _p2d_scene_fill_joint(&scene->joints[j], objects, &joints[j]);
+        p2d_add_joint(&joints[j]);
+    }
+
+    p2d_logf(P2D_LOG_INFO, "p2d_scene_load: loaded %d objects and %d joints%s.\n", count, scene->joint_count, baked ? " (with baked static tiles)" : "");
+    return true;
+}
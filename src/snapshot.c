@@ -0,0 +1,296 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/context.h"
+#include "p2d/world.h"
+#include "p2d/joint.h"
+#include "p2d/region.h"
+#include "p2d/snapshot.h"
+#include "p2d/statehash.h"
+#include "p2d/triggers.h"
+#include "internal.h"
+
+#define P2D_SNAPSHOT_MAGIC 0x53443250u // "P2DS"
+#define P2D_SNAPSHOT_VERSION 4u
+
+// object state bits, see the state column
+#define P2D_SNAPSHOT_SLEEPING   (1 << 0)
+#define P2D_SNAPSHOT_CULLED     (1 << 1)
+#define P2D_SNAPSHOT_PARKED     (1 << 2)
+
+struct p2d_snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+
+    unsigned int step_count;
+    int body_count;
+    int handle_count;
+    int free_count;
+    int joint_count;
+    int parked_count;
+    int trigger_count;
+    int reserved;
+};
+
+/*
+    Every column after the header, each starting 8 byte aligned.
+    Body columns are in dense order, which is also the order bodies were registered in.
+*/
+#define P2D_SNAPSHOT_COLUMNS(X) \
+    X(struct p2d_object *, objects, bodies) \
+    X(int, handles, bodies) \
+    X(int, index, handle_count) /* handle -> row, -1 if free */ \
+    X(float, x, bodies) \
+    X(float, y, bodies) \
+    X(float, rotation, bodies) \
+    X(float, vx, bodies) \
+    X(float, vy, bodies) \
+    X(float, vr, bodies) \
+    X(float, inv_mass, bodies) \
+    X(float, inv_inertia, bodies) \
+    X(float, sleep_time, bodies) \
+    X(int, island_next, bodies) /* handle, -1 outside of sleeping islands */ \
+    X(int, lod, bodies) \
+    X(uint8_t, state, bodies) \
+    X(int, free_handles, free) \
+    X(struct p2d_joint *, joints, joints) \
+    X(struct p2d_joint, joint_values, joints) \
+    X(struct p2d_trigger_pair, trigger_pairs, triggers) /* so rolling back doesn't enter zones again */
+
+struct p2d_snapshot_layout {
+    #define X(type, name, count) size_t name;
+    P2D_SNAPSHOT_COLUMNS(X)
+    #undef X
+    size_t size;
+};
+
+static size_t _p2d_snapshot_align(size_t offset) {
+    return (offset + 7) & ~(size_t)7;
+}
+
+static struct p2d_snapshot_layout _p2d_snapshot_layout(int bodies, int handle_count, int free, int joints, int triggers) {
+    struct p2d_snapshot_layout layout;
+    size_t offset = _p2d_snapshot_align(sizeof(struct p2d_snapshot_header));
+
+    #define X(type, name, count) \
+        layout.name = offset; \
+        offset = _p2d_snapshot_align(offset + (size_t)(count) * sizeof(type));
+    P2D_SNAPSHOT_COLUMNS(X)
+    #undef X
+
+    layout.size = offset;
+    return layout;
+}
+
+size_t p2d_snapshot_size(void) {
+    return _p2d_snapshot_layout(p2d_bodies.count, p2d_bodies.handle_count, p2d_bodies.free_count, p2d_state.p2d_joint_count, p2d_triggers.count).size;
+}
+
+size_t p2d_snapshot_save(void *buffer, size_t size) {
+    struct p2d_body_store *s = &p2d_bodies;
+    int count = s->count;
+
+    if(!buffer || ((uintptr_t)buffer & 7) != 0) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_snapshot_save: buffer is NULL or not 8 byte aligned.\n");
+        return 0;
+    }
+
+    struct p2d_snapshot_layout layout = _p2d_snapshot_layout(count, s->handle_count, s->free_count, p2d_state.p2d_joint_count, p2d_triggers.count);
+    if(size < layout.size) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_snapshot_save: buffer is %zu bytes, %zu are needed.\n", size, layout.size);
+        return 0;
+    }
+
+    unsigned char *base = buffer;
+    #define X(type, name, count) type *name = (type *)(base + layout.name);
+    P2D_SNAPSHOT_COLUMNS(X)
+    #undef X
+
+    struct p2d_snapshot_header *header = buffer;
+    *header = (struct p2d_snapshot_header){
+        .magic = P2D_SNAPSHOT_MAGIC,
+        .version = P2D_SNAPSHOT_VERSION,
+        .size = layout.size,
+        .step_count = p2d_state.p2d_step_count,
+        .body_count = count,
+        .handle_count = s->handle_count,
+        .free_count = s->free_count,
+        .joint_count = p2d_state.p2d_joint_count,
+        .parked_count = p2d_state.p2d_parked_count,
+        .trigger_count = p2d_triggers.count
+    };
+
+    memcpy(objects, p2d_objects, (size_t)count * sizeof(*objects));
+    memcpy(handles, s->handle, (size_t)count * sizeof(*handles));
+    memcpy(index, s->index, (size_t)s->handle_count * sizeof(*index));
+    memcpy(free_handles, s->free_handles, (size_t)s->free_count * sizeof(*free_handles));
+    memcpy(joints, p2d_joints, (size_t)header->joint_count * sizeof(*joints));
+    // the pairs aren't allocated until a trigger first overlaps something
+    if(header->trigger_count > 0) {
+        memcpy(trigger_pairs, p2d_triggers.pairs, (size_t)header->trigger_count * sizeof(*trigger_pairs));
+    }
+
+    // between steps the objects are what the next step starts from, not the store
+    for(int i = 0; i < count; i++) {
+        const struct p2d_object *object = p2d_objects[i];
+
+        x[i] = object->x;
+        y[i] = object->y;
+        rotation[i] = object->rotation;
+        vx[i] = object->vx;
+        vy[i] = object->vy;
+        vr[i] = object->vr;
+        inv_mass[i] = object->inv_mass;
+        inv_inertia[i] = object->inv_inertia;
+        sleep_time[i] = object->sleep_time;
+        island_next[i] = object->island_next ? object->island_next->handle : -1;
+        lod[i] = object->lod;
+        state[i] = (uint8_t)((object->sleeping ? P2D_SNAPSHOT_SLEEPING : 0) |
+                             (object->culled ? P2D_SNAPSHOT_CULLED : 0) |
+                             (object->parked ? P2D_SNAPSHOT_PARKED : 0));
+    }
+
+    for(int j = 0; j < header->joint_count; j++) {
+        joint_values[j] = *p2d_joints[j];
+    }
+
+    return layout.size;
+}
+
+bool p2d_snapshot_restore(const void *buffer, size_t size) {
+    struct p2d_body_store *s = &p2d_bodies;
+
+    const struct p2d_snapshot_header *header = buffer;
+    if(!buffer || ((uintptr_t)buffer & 7) != 0 || size < sizeof(*header) ||
+       header->magic != P2D_SNAPSHOT_MAGIC || header->version != P2D_SNAPSHOT_VERSION) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_snapshot_restore: buffer is not a snapshot.\n");
+        return false;
+    }
+
+    int count = header->body_count;
+    struct p2d_snapshot_layout layout = _p2d_snapshot_layout(count, header->handle_count, header->free_count, header->joint_count, header->trigger_count);
+    if(header->size != layout.size || size < layout.size) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_snapshot_restore: snapshot is truncated.\n");
+        return false;
+    }
+
+    const unsigned char *base = buffer;
+    #define X(type, name, count) const type *name = (const type *)(base + layout.name);
+    P2D_SNAPSHOT_COLUMNS(X)
+    #undef X
+
+    // grow first, so nothing has changed yet if it can't
+    if(!p2d_bodies_reserve(header->handle_count) || !p2d_joints_reserve(header->joint_count) ||
+       !p2d_triggers_restore(trigger_pairs, header->trigger_count)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_snapshot_restore: could not grow back to %d objects and %d joints.\n", header->handle_count, header->joint_count);
+        return false;
+    }
+
+    /*
+        Drop every object as it is now. Culled objects that stay culled where they are keep their
+        spot in the culled table, the rest go back to normal first.
+    */
+    for(int i = 0; i < s->count; i++) {
+        struct p2d_object *object = p2d_objects[i];
+        p2d_unpark_object(object);
+
+        if(object->culled) {
+            int h = object->handle;
+            int row = h < header->handle_count ? index[h] : -1;
+            bool stays = row >= 0 && objects[row] == object && (state[row] & P2D_SNAPSHOT_CULLED) &&
+                         x[row] == object->x && y[row] == object->y && rotation[row] == object->rotation;
+            if(!stays) {
+                p2d_release_culled_object(object);
+            }
+        }
+
+        object->handle = -1;
+        object->island_next = NULL;
+        p2d_objects[i] = NULL;
+    }
+
+    /*
+        Handles come back exactly as they were, so anything holding on to one stays valid
+    */
+    s->count = count;
+    s->handle_count = header->handle_count;
+    s->free_count = header->free_count;
+    memcpy(s->handle, handles, (size_t)count * sizeof(*handles));
+    memcpy(s->index, index, (size_t)header->handle_count * sizeof(*index));
+    memcpy(s->free_handles, free_handles, (size_t)header->free_count * sizeof(*free_handles));
+    memcpy(p2d_objects, objects, (size_t)count * sizeof(*objects));
+
+    for(int i = 0; i < count; i++) {
+        struct p2d_object *object = p2d_objects[i];
+        object->handle = handles[i];
+
+        // same write back as p2d_bodies_scatter, but it jumps rather than moves
+        p2d_body_output(object, x[i], y[i], rotation[i]);
+        s->previous_transforms[handles[i]] = s->transforms[handles[i]];
+
+        object->x = x[i];
+        object->y = y[i];
+        object->rotation = rotation[i];
+        object->vx = vx[i];
+        object->vy = vy[i];
+        object->vr = vr[i];
+        object->inv_mass = inv_mass[i];
+        object->inv_inertia = inv_inertia[i];
+        object->sleep_time = sleep_time[i];
+        object->lod = lod[i];
+        object->sleeping = (state[i] & P2D_SNAPSHOT_SLEEPING) != 0;
+        object->parked = (state[i] & P2D_SNAPSHOT_PARKED) != 0;
+    }
+
+    for(int i = 0; i < count; i++) {
+        struct p2d_object *object = p2d_objects[i];
+        object->island_next = island_next[i] >= 0 ? p2d_objects[index[island_next[i]]] : NULL;
+
+        if(state[i] & P2D_SNAPSHOT_CULLED) {
+            p2d_cull_object(object);
+        }
+    }
+
+    /*
+        The next step's gather keeps settled bodies as the store has them, and wakes sleeping ones
+        that don't match it (they look pushed), so the store has to agree with the objects already
+    */
+    for(int i = 0; i < count; i++) {
+        p2d_body_reload(i);
+    }
+
+    // anything may have changed, so the changed list is everything
+    memcpy(s->changed, handles, (size_t)count * sizeof(*handles));
+    s->changed_count = count;
+    for(int i = 0; i < count; i++) {
+        s->reported_sleeping[handles[i]] = (state[i] & P2D_SNAPSHOT_SLEEPING) != 0;
+    }
+
+    p2d_state.p2d_object_count = count;
+    p2d_state.p2d_parked_count = header->parked_count;
+    p2d_state.p2d_step_count = header->step_count;
+
+    // joints come back in their old order, with their old values
+    memcpy(p2d_joints, joints, (size_t)header->joint_count * sizeof(*joints));
+    for(int j = 0; j < header->joint_count; j++) {
+        *p2d_joints[j] = joint_values[j];
+    }
+    p2d_state.p2d_joint_count = header->joint_count;
+
+    // the resting table may list bodies that are awake now, or miss ones that are asleep
+    p2d_world_mark_resting_dirty();
+    p2d_world_mark_statics_dirty();
+    p2d_state_hash_invalidate();
+    return true;
+}
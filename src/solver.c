@@ -0,0 +1,317 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/core.h"
+#include "p2d/body.h"
+#include "p2d/jobs.h"
+#include "p2d/pairs.h"
+#include "p2d/island.h"
+#include "p2d/solver.h"
+#include "p2d/context.h"
+#include "p2d/memory.h"
+#include "p2d/events.h"
+#include "p2d/contacts.h"
+#include "p2d/resolution.h"
+#include "p2d/narrowphase.h"
+#include "internal.h"
+
+//
+// COLORING
+//
+
+int *p2d_constraint_bodies(int count) {
+    if(!p2d_grow((void **)&p2d_solver.bodies, &p2d_solver.body_capacity, 2 * count, sizeof(int))) {
+        return NULL;
+    }
+    return p2d_solver.bodies;
+}
+
+bool p2d_color_constraints(const int *bodies, int count, struct p2d_color_batches *batches) {
+    struct p2d_solver_store *solver = &p2d_solver;
+
+    int handles = p2d_bodies.handle_count;
+    if(!p2d_grow((void **)&batches->order, &batches->capacity, count, sizeof(int)) ||
+       !p2d_grow((void **)&solver->colors, &solver->colors_capacity, count, sizeof(int)) ||
+       !p2d_grow((void **)&solver->taken, &solver->taken_capacity, handles, sizeof(unsigned long long))) {
+        return false;
+    }
+    memset(solver->taken, 0, (size_t)handles * sizeof(unsigned long long));
+
+    int counts[P2D_MAX_COLORS + 1] = {0};
+    int *color = solver->colors;
+
+    for(int k = 0; k < count; k++) {
+        int a = bodies[2 * k];
+        int b = bodies[2 * k + 1];
+
+        unsigned long long taken = 0;
+        if(a >= 0 && a < handles) {
+            taken |= solver->taken[a];
+        }
+        if(b >= 0 && b < handles) {
+            taken |= solver->taken[b];
+        }
+
+        // lowest color neither body is in yet
+        int c = 0;
+        while(c < P2D_MAX_COLORS && (taken & (1ull << c))) {
+            c++;
+        }
+
+        if(c < P2D_MAX_COLORS) {
+            if(a >= 0 && a < handles) {
+                solver->taken[a] |= 1ull << c;
+            }
+            if(b >= 0 && b < handles) {
+                solver->taken[b] |= 1ull << c;
+            }
+        }
+
+        color[k] = c;
+        counts[c]++;
+    }
+
+    batches->start[0] = 0;
+    for(int c = 0; c <= P2D_MAX_COLORS; c++) {
+        batches->start[c + 1] = batches->start[c] + counts[c];
+    }
+
+    // stable, constraints keep their relative order inside a color
+    int next[P2D_MAX_COLORS + 1];
+    memcpy(next, batches->start, sizeof(next));
+
+    for(int k = 0; k < count; k++) {
+        batches->order[next[color[k]]++] = k;
+    }
+
+    return true;
+}
+
+struct p2d_batch_job {
+    p2d_job_fn fn;
+    void *data;
+    int offset;
+};
+
+static void _p2d_batch_range(void *data, int begin, int end, int thread) {
+    struct p2d_batch_job *job = data;
+    job->fn(job->data, job->offset + begin, job->offset + end, thread);
+}
+
+void p2d_solve_batches(const struct p2d_color_batches *batches, p2d_job_fn fn, void *data) {
+    for(int c = 0; c < P2D_MAX_COLORS; c++) {
+        int begin = batches->start[c];
+        int end = batches->start[c + 1];
+        if(begin == end) {
+            continue;
+        }
+
+        struct p2d_batch_job job = {fn, data, begin};
+        p2d_parallel_for(end - begin, P2D_SOLVER_GRAIN, _p2d_batch_range, &job);
+    }
+
+    // everything that ran out of colors shares bodies with something, so one at a time
+    int overflow = batches->start[P2D_MAX_COLORS];
+    if(overflow < batches->start[P2D_MAX_COLORS + 1]) {
+        fn(data, overflow, batches->start[P2D_MAX_COLORS + 1], 0);
+    }
+}
+
+//
+// CONTACTS
+//
+
+/*
+    Everything about a touching candidate that has to happen serially, in candidate order.
+*/
+static void _p2d_prepare_contact(int k, const struct p2d_narrow_manifold *narrow) {
+    const struct p2d_candidate *candidate = &p2d_narrowphase.candidates[k];
+    int ia = p2d_body_index(candidate->a);
+    int ib = p2d_body_index(candidate->b);
+
+    uint8_t flags_a = p2d_bodies.flags[ia];
+    uint8_t flags_b = p2d_bodies.flags[ib];
+
+    // woken since it was listed, it will be back in the awake table next rebuild
+    if((candidate->flags & P2D_CANDIDATE_RESTING) && !((flags_a | flags_b) & P2D_BODY_SLEEPING)) {
+        return;
+    }
+
+    struct p2d_object *a = p2d_objects[ia];
+    struct p2d_object *b = p2d_objects[ib];
+
+    // if already collided, skip
+    if(p2d_collision_pair_exists(a, b)) {
+        return;
+    }
+
+    p2d_add_collision_pair(a, b);
+
+    // something awake ran into a sleeping island
+    if(flags_a & P2D_BODY_SLEEPING) {
+        p2d_wake_object(a);
+    }
+    if(flags_b & P2D_BODY_SLEEPING) {
+        p2d_wake_object(b);
+    }
+
+    p2d_islands_link(candidate->a, candidate->b);
+
+    struct p2d_solver_store *solver = &p2d_solver;
+    if(!p2d_grow((void **)&solver->contacts, &solver->contact_capacity, solver->contact_count + 1, sizeof(struct p2d_contact_constraint))) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_solve_contacts: out of memory, dropping contacts.\n");
+        return;
+    }
+
+    struct p2d_contact_constraint *constraint = &solver->contacts[solver->contact_count++];
+    constraint->candidate = k;
+    constraint->resolved = false;
+    constraint->manifold = *narrow;
+    constraint->impulse = 0.0f;
+}
+
+// separation and resolution, only ever run on constraints that share no body that can move
+static void _p2d_solve_contact_range(void *data, int begin, int end, int thread) {
+    const struct p2d_color_batches *batches = data;
+    (void)thread;
+
+    for(int n = begin; n < end; n++) {
+        struct p2d_contact_constraint *constraint = &p2d_solver.contacts[batches->order[n]];
+        const struct p2d_candidate *candidate = &p2d_narrowphase.candidates[constraint->candidate];
+        int ia = constraint->a;
+        int ib = constraint->b;
+
+        // earlier colors may have pushed either of them since the narrow phase
+        struct p2d_narrow_manifold *found = &constraint->manifold;
+        if(!p2d_refresh_manifold(candidate, found)) {
+            continue;
+        }
+
+        struct p2d_object pa, pb;
+        p2d_body_proxy(ia, &pa);
+        p2d_body_proxy(ib, &pb);
+
+        // seperate after contacts - i think 2bit had some weird deferred movement
+        vec2_t from_a = {{pa.x, pa.y}};
+        vec2_t from_b = {{pb.x, pb.y}};
+        p2d_separate_bodies(&pa, &pb, found->info.normal, found->info.depth);
+        p2d_narrowphase_moved(candidate->a, (vec2_t){{pa.x - from_a.x, pa.y - from_a.y}});
+        p2d_narrowphase_moved(candidate->b, (vec2_t){{pb.x - from_b.x, pb.y - from_b.y}});
+
+        // static bodies are shared between constraints of the same color, only ever read them
+        if(!pa.is_static) {
+            p2d_body_store_pose(ia, &pa);
+        }
+        if(!pb.is_static) {
+            p2d_body_store_pose(ib, &pb);
+        }
+
+        // early out
+        if(found->contact_count <= 0) {
+            continue;
+        }
+
+        // create contact manifold for resolution
+        struct p2d_contact_list contacts = {
+            .contacts = found->contacts,
+            .count = (size_t)found->contact_count,
+            .capacity = (size_t)found->contact_count
+        };
+        struct p2d_collision_manifold manifold =
+            p2d_generate_manifold(&pa, &pb, found->info.normal, found->info.depth, &contacts);
+
+        // now, resolve their collision
+        p2d_resolve_collision(&manifold);
+        constraint->impulse = manifold.impulse;
+        if(!pa.is_static) {
+            p2d_body_store_velocity(ia, &pa);
+        }
+        if(!pb.is_static) {
+            p2d_body_store_velocity(ib, &pb);
+        }
+
+        constraint->resolved = true;
+    }
+}
+
+void p2d_solve_contacts(void) {
+    struct p2d_solver_store *solver = &p2d_solver;
+    solver->contact_count = 0;
+
+    for(int k = 0; k < p2d_narrowphase.candidate_count; k++) {
+        const struct p2d_narrow_manifold *found = p2d_candidate_manifold(&p2d_narrowphase.candidates[k]);
+        if(found) {
+            _p2d_prepare_contact(k, found);
+        }
+    }
+
+    int count = solver->contact_count;
+    if(count == 0) {
+        return;
+    }
+
+    // nothing is added or removed during a step, so body indices hold still
+    int *bodies = p2d_constraint_bodies(count);
+    if(!bodies) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_solve_contacts: out of memory, dropping contacts.\n");
+        return;
+    }
+
+    for(int k = 0; k < count; k++) {
+        struct p2d_contact_constraint *constraint = &solver->contacts[k];
+        const struct p2d_candidate *candidate = &p2d_narrowphase.candidates[constraint->candidate];
+
+        constraint->a = p2d_body_index(candidate->a);
+        constraint->b = p2d_body_index(candidate->b);
+
+        bodies[2 * k] = (p2d_bodies.flags[constraint->a] & P2D_BODY_STATIC) ? -1 : candidate->a;
+        bodies[2 * k + 1] = (p2d_bodies.flags[constraint->b] & P2D_BODY_STATIC) ? -1 : candidate->b;
+    }
+
+    struct p2d_color_batches *batches = &solver->contact_batches;
+    if(!p2d_color_constraints(bodies, count, batches)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_solve_contacts: out of memory, dropping contacts.\n");
+        return;
+    }
+
+    p2d_solve_batches(batches, _p2d_solve_contact_range, batches);
+
+    for(int k = 0; k < count; k++) {
+        struct p2d_contact_constraint *constraint = &solver->contacts[k];
+        if(!constraint->resolved) {
+            continue;
+        }
+
+        p2d_state.p2d_contacts_found += constraint->manifold.contact_count;
+
+        // debug: add all contacts to the global list
+        if(p2d_state.out_contacts) {
+            for(int z = 0; z < constraint->manifold.contact_count; z++) {
+                p2d_contact_list_add(p2d_state.out_contacts, constraint->manifold.contacts[z]);
+            }
+        }
+
+        // reported once the step is over
+        const struct p2d_candidate *candidate = &p2d_narrowphase.candidates[constraint->candidate];
+        p2d_events_record(P2D_EVENT_COLLISION, candidate->a, candidate->b, &constraint->manifold, constraint->impulse);
+    }
+}
+
+void p2d_solver_shutdown(void) {
+    p2d_free(p2d_solver.contacts, (size_t)p2d_solver.contact_capacity * sizeof(*p2d_solver.contacts));
+    p2d_free(p2d_solver.bodies, (size_t)p2d_solver.body_capacity * sizeof(*p2d_solver.bodies));
+    p2d_free(p2d_solver.taken, (size_t)p2d_solver.taken_capacity * sizeof(*p2d_solver.taken));
+    p2d_free(p2d_solver.colors, (size_t)p2d_solver.colors_capacity * sizeof(*p2d_solver.colors));
+    p2d_free(p2d_solver.contact_batches.order, (size_t)p2d_solver.contact_batches.capacity * sizeof(*p2d_solver.contact_batches.order));
+    p2d_free(p2d_solver.joint_batches.order, (size_t)p2d_solver.joint_batches.capacity * sizeof(*p2d_solver.joint_batches.order));
+
+    memset(&p2d_solver, 0, sizeof(p2d_solver));
+}
@@ -0,0 +1,169 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/context.h"
+#include "p2d/memory.h"
+#include "p2d/statehash.h"
+#include "internal.h"
+
+// splitmix64's finalizer
+static uint64_t _p2d_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t _p2d_bits(float a, float b) {
+    uint32_t lo, hi;
+    memcpy(&lo, &a, sizeof(lo));
+    memcpy(&hi, &b, sizeof(hi));
+    return (uint64_t)lo | ((uint64_t)hi << 32);
+}
+
+// one body's term, straight off the packed columns
+static uint64_t _p2d_body_term(const struct p2d_body_store *s, int i) {
+    uint64_t term = _p2d_mix((uint64_t)(uint32_t)s->handle[i] * 0x9E3779B97F4A7C15ull ^ (uint64_t)((s->flags[i] & P2D_BODY_SLEEPING) != 0));
+    term = _p2d_mix(term ^ _p2d_bits(s->x[i], s->y[i]));
+    term = _p2d_mix(term ^ _p2d_bits(s->rotation[i], s->vx[i]));
+    term = _p2d_mix(term ^ _p2d_bits(s->vy[i], s->vr[i]));
+    return term;
+}
+
+static uint64_t _p2d_finish(uint64_t sum, int count) {
+    return _p2d_mix(sum ^ _p2d_mix((uint64_t)(uint32_t)count + 0x9E3779B97F4A7C15ull));
+}
+
+static int _p2d_region_cell(float position) {
+    float cell = floorf(position / (float)(p2d_state.p2d_cell_size * P2D_HASH_REGION_SCALE));
+
+    // bodies that flew off to infinity (or NaN) still need a region
+    if(!(fabsf(cell) < 1e9f)) {
+        return 0;
+    }
+    return (int)cell;
+}
+
+int p2d_state_hash_region(float x, float y) {
+    unsigned int cx = (unsigned int)_p2d_region_cell(x);
+    unsigned int cy = (unsigned int)_p2d_region_cell(y);
+    return (int)(((cx * 73856093u) ^ (cy * 19349663u)) & (P2D_HASH_REGIONS - 1));
+}
+
+uint64_t p2d_state_hash(void) {
+    const struct p2d_body_store *s = &p2d_bodies;
+
+    // order doesn't matter, so this is a plain reduction over the columns
+    uint64_t sum = 0;
+    for(int i = 0; i < s->count; i++) {
+        sum += _p2d_body_term(s, i);
+    }
+
+    return _p2d_finish(sum, s->count);
+}
+
+void p2d_state_hash_regions(uint64_t out[P2D_HASH_REGIONS]) {
+    const struct p2d_body_store *s = &p2d_bodies;
+
+    uint64_t sums[P2D_HASH_REGIONS] = {0};
+    int counts[P2D_HASH_REGIONS] = {0};
+
+    for(int i = 0; i < s->count; i++) {
+        int region = p2d_state_hash_region(s->x[i], s->y[i]);
+        sums[region] += _p2d_body_term(s, i);
+        counts[region]++;
+    }
+
+    for(int r = 0; r < P2D_HASH_REGIONS; r++) {
+        out[r] = _p2d_finish(sums[r], counts[r]);
+    }
+}
+
+//
+// RUNNING HASH
+//
+
+static bool _p2d_state_hash_reserve(int needed) {
+    struct p2d_state_hash_store *store = &p2d_state_hashes;
+    return p2d_grow((void **)&store->terms, &store->capacity, needed, sizeof(*store->terms));
+}
+
+void p2d_state_hash_update(void) {
+    struct p2d_state_hash_store *store = &p2d_state_hashes;
+    const struct p2d_body_store *s = &p2d_bodies;
+
+    if(!_p2d_state_hash_reserve(s->handle_count)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_state_hash_update: out of memory, hashing from scratch.\n");
+        p2d_state_hash_invalidate();
+        p2d_state.p2d_step_hash = p2d_state_hash();
+        return;
+    }
+
+    if(!store->valid) {
+        memset(store->terms, 0, (size_t)store->capacity * sizeof(*store->terms));
+        memset(store->sums, 0, sizeof(store->sums));
+        memset(store->counts, 0, sizeof(store->counts));
+        store->valid = true;
+    }
+
+    /*
+        Bodies that were asleep or culled for the whole step haven't moved since they were last hashed.
+        Static ones aren't touched either, but the user may have moved them, and they're cheap.
+    */
+    for(int i = 0; i < s->count; i++) {
+        int h = s->handle[i];
+        if(store->terms[h].counted && !(s->flags[i] & (P2D_BODY_TOUCHED | P2D_BODY_STATIC))) {
+            continue;
+        }
+
+        if(store->terms[h].counted) {
+            store->sums[store->terms[h].region] -= store->terms[h].term;
+            store->counts[store->terms[h].region]--;
+        }
+
+        uint64_t term = _p2d_body_term(s, i);
+        int region = p2d_state_hash_region(s->x[i], s->y[i]);
+
+        store->terms[h] = (struct p2d_state_hash_term){term, (uint8_t)region, true};
+        store->sums[region] += term;
+        store->counts[region]++;
+    }
+
+    uint64_t sum = 0;
+    int count = 0;
+    for(int r = 0; r < P2D_HASH_REGIONS; r++) {
+        sum += store->sums[r];
+        count += store->counts[r];
+    }
+    p2d_state.p2d_step_hash = _p2d_finish(sum, count);
+}
+
+void p2d_state_hash_forget(int handle) {
+    struct p2d_state_hash_store *store = &p2d_state_hashes;
+    if(!store->valid || handle < 0 || handle >= store->capacity || !store->terms[handle].counted) {
+        return;
+    }
+
+    store->sums[store->terms[handle].region] -= store->terms[handle].term;
+    store->counts[store->terms[handle].region]--;
+    store->terms[handle].counted = false;
+}
+
+void p2d_state_hash_invalidate(void) {
+    p2d_state_hashes.valid = false;
+}
+
+void p2d_state_hash_shutdown(void) {
+    p2d_free(p2d_state_hashes.terms, (size_t)p2d_state_hashes.capacity * sizeof(*p2d_state_hashes.terms));
+    p2d_state_hashes = (struct p2d_state_hash_store){0};
+}
@@ -0,0 +1,236 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "p2d/log.h"
+#include "p2d/body.h"
+#include "p2d/core.h"
+#include "p2d/jobs.h"
+#include "p2d/context.h"
+#include "p2d/memory.h"
+#include "p2d/helpers.h"
+#include "p2d/detection.h"
+#include "p2d/events.h"
+#include "p2d/triggers.h"
+#include "p2d/narrowphase.h"
+#include "internal.h"
+
+static int _p2d_compare_pairs(int a0, int b0, int a1, int b1) {
+    if(a0 != a1) {
+        return (a0 > a1) - (a0 < a1);
+    }
+    return (b0 > b1) - (b0 < b1);
+}
+
+static int _p2d_compare_stays(const void *a, const void *b) {
+    const struct p2d_event *ea = &p2d_events.events[*(const int *)a];
+    const struct p2d_event *eb = &p2d_events.events[*(const int *)b];
+    return _p2d_compare_pairs(ea->handle_a, ea->handle_b, eb->handle_a, eb->handle_b);
+}
+
+// first pair in [begin, end) that doesn't sort before (a, b)
+static int _p2d_trigger_lower_bound(int a, int b, int begin, int end) {
+    while(begin < end) {
+        int mid = begin + (end - begin) / 2;
+        const struct p2d_trigger_pair *pair = &p2d_triggers.pairs[mid];
+        if(_p2d_compare_pairs(pair->a, pair->b, a, b) < 0) {
+            begin = mid + 1;
+        }
+        else {
+            end = mid;
+        }
+    }
+    return begin;
+}
+
+const struct p2d_trigger_pair *p2d_get_trigger_overlaps(int *count) {
+    if(count) {
+        *count = p2d_triggers.count;
+    }
+    return p2d_triggers.pairs;
+}
+
+bool p2d_trigger_overlapping(struct p2d_object *a, struct p2d_object *b) {
+    if(!a || !b || a->handle < 0 || b->handle < 0) {
+        return false;
+    }
+
+    struct p2d_trigger_pair key = {a->handle, b->handle};
+    if(key.a > key.b) {
+        key = (struct p2d_trigger_pair){b->handle, a->handle};
+    }
+
+    int at = _p2d_trigger_lower_bound(key.a, key.b, 0, p2d_triggers.count);
+    return at < p2d_triggers.count && p2d_triggers.pairs[at].a == key.a && p2d_triggers.pairs[at].b == key.b;
+}
+
+// shape tests only, each job owns its own sensor pairs
+static void _p2d_sensor_range(void *data, int begin, int end, int thread) {
+    (void)data;
+    (void)thread;
+
+    for(int k = begin; k < end; k++) {
+        struct p2d_candidate *sensor = &p2d_narrowphase.sensors[k];
+        int ia = p2d_body_index(sensor->a);
+        int ib = p2d_body_index(sensor->b);
+
+        if(!p2d_aabbs_intersect(p2d_bodies.aabb[ia], p2d_bodies.aabb[ib]) ||
+           !p2d_should_collide(p2d_objects[ia], p2d_objects[ib])) {
+            continue;
+        }
+
+        struct p2d_object pa, pb;
+        p2d_body_proxy(ia, &pa);
+        p2d_body_proxy(ib, &pb);
+        if(p2d_objects_intersect(&pa, &pb)) {
+            sensor->flags |= P2D_CANDIDATE_OVERLAPPING;
+        }
+    }
+}
+
+void p2d_triggers_detect(void) {
+    p2d_parallel_for(p2d_narrowphase.sensor_count, P2D_JOB_GRAIN, _p2d_sensor_range, NULL);
+
+    for(int k = 0; k < p2d_narrowphase.sensor_count; k++) {
+        const struct p2d_candidate *sensor = &p2d_narrowphase.sensors[k];
+        if(sensor->flags & P2D_CANDIDATE_OVERLAPPING) {
+            p2d_events_record(P2D_EVENT_TRIGGER_STAY, sensor->a, sensor->b, NULL, 0.0f);
+        }
+    }
+}
+
+// an overlap that wasn't found again, kept while nothing about either body could have changed
+static bool _p2d_trigger_pair_held(const struct p2d_trigger_pair *pair) {
+    int ia = p2d_body_index(pair->a);
+    int ib = p2d_body_index(pair->b);
+    if(ia < 0 || ib < 0) {
+        return false;
+    }
+
+    uint8_t changing = P2D_BODY_TOUCHED | P2D_BODY_INACTIVE;
+    return !((p2d_bodies.flags[ia] | p2d_bodies.flags[ib]) & changing);
+}
+
+void p2d_triggers_update(void) {
+    struct p2d_trigger_store *store = &p2d_triggers;
+
+    // this step's overlaps, in pair order
+    int stays = 0;
+    for(int i = 0; i < p2d_events.count; i++) {
+        if(p2d_events.events[i].type != P2D_EVENT_TRIGGER_STAY) {
+            continue;
+        }
+        if(!p2d_grow((void **)&store->order, &store->order_capacity, stays + 1, sizeof(int))) {
+            p2d_logf(P2D_LOG_ERROR, "p2d_triggers_update: out of memory, trigger overlaps not updated.\n");
+            return;
+        }
+        store->order[stays++] = i;
+    }
+    if(stays > 1) {
+        qsort(store->order, (size_t)stays, sizeof(int), _p2d_compare_stays);
+    }
+
+    // at most every old pair and every new one
+    if(!p2d_grow((void **)&store->next, &store->next_capacity, store->count + stays, sizeof(struct p2d_trigger_pair))) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_triggers_update: out of memory, trigger overlaps not updated.\n");
+        return;
+    }
+
+    int next = 0;
+    int old = 0;
+    int now = 0;
+    while(old < store->count || now < stays) {
+        struct p2d_event *event = now < stays ? &p2d_events.events[store->order[now]] : NULL;
+        const struct p2d_trigger_pair *pair = old < store->count ? &store->pairs[old] : NULL;
+
+        int order = !event ? -1 : !pair ? 1 : _p2d_compare_pairs(pair->a, pair->b, event->handle_a, event->handle_b);
+        if(order == 0) {
+            store->next[next++] = *pair;
+            old++;
+            now++;
+        }
+        else if(order > 0) {
+            event->type = P2D_EVENT_TRIGGER_ENTER;
+            store->next[next++] = (struct p2d_trigger_pair){event->handle_a, event->handle_b};
+            now++;
+        }
+        else {
+            if(_p2d_trigger_pair_held(pair)) {
+                store->next[next++] = *pair;
+            }
+            else {
+                p2d_events_record(P2D_EVENT_TRIGGER_EXIT, pair->a, pair->b, NULL, 0.0f);
+            }
+            old++;
+        }
+    }
+
+    struct p2d_trigger_pair *swap = store->pairs;
+    int swap_capacity = store->capacity;
+    store->pairs = store->next;
+    store->capacity = store->next_capacity;
+    store->next = swap;
+    store->next_capacity = swap_capacity;
+    store->count = next;
+}
+
+void p2d_triggers_forget(int handle) {
+    struct p2d_trigger_store *store = &p2d_triggers;
+
+    // pairs where it is a are one run, handles are never negative
+    int first = _p2d_trigger_lower_bound(handle, -1, 0, store->count);
+    int removed = first < store->count && store->pairs[first].a == handle ? first : store->count;
+
+    // where it is b, at most one pair in each run of a smaller a
+    for(int run = 0; run < first;) {
+        int a = store->pairs[run].a;
+        int at = _p2d_trigger_lower_bound(a, handle, run, first);
+        if(at < first && store->pairs[at].a == a && store->pairs[at].b == handle) {
+            removed = at;
+            break;
+        }
+        run = _p2d_trigger_lower_bound(a + 1, -1, at, first);
+    }
+
+    if(removed == store->count) {
+        return;
+    }
+
+    int kept = removed;
+    for(int i = removed; i < store->count; i++) {
+        if(store->pairs[i].a != handle && store->pairs[i].b != handle) {
+            store->pairs[kept++] = store->pairs[i];
+        }
+    }
+    store->count = kept;
+}
+
+bool p2d_triggers_restore(const struct p2d_trigger_pair *pairs, int count) {
+    struct p2d_trigger_store *store = &p2d_triggers;
+    if(!p2d_grow((void **)&store->pairs, &store->capacity, count, sizeof(*pairs))) {
+        return false;
+    }
+
+    if(count > 0) {
+        memcpy(store->pairs, pairs, (size_t)count * sizeof(*pairs));
+    }
+    store->count = count;
+    return true;
+}
+
+void p2d_triggers_clear(void) {
+    p2d_triggers.count = 0;
+}
+
+void p2d_triggers_shutdown(void) {
+    p2d_free(p2d_triggers.pairs, (size_t)p2d_triggers.capacity * sizeof(*p2d_triggers.pairs));
+    p2d_free(p2d_triggers.next, (size_t)p2d_triggers.next_capacity * sizeof(*p2d_triggers.next));
+    p2d_free(p2d_triggers.order, (size_t)p2d_triggers.order_capacity * sizeof(*p2d_triggers.order));
+    memset(&p2d_triggers, 0, sizeof(p2d_triggers));
+}
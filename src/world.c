@@ -8,39 +8,186 @@
 #include <stdlib.h>
 
 #include "p2d/log.h"
+#include "p2d/body.h"
 #include "p2d/core.h"
+#include "p2d/context.h"
 #include "p2d/world.h"
+#include "p2d/memory.h"
+#include "p2d/region.h"
 #include "p2d/helpers.h"
 #include "p2d/detection.h"
+#include "internal.h"
 
-// collection of world tiles
-struct p2d_object * p2d_objects[P2D_MAX_OBJECTS] = {NULL};
-struct p2d_world_node *p2d_world[P2D_MAX_OBJECTS] = {NULL};
+#define P2D_WORLD_CHUNK_NODES 1024
+
+struct p2d_world_chunk {
+    struct p2d_world_chunk *next;
+    int used;
+    struct p2d_world_node nodes[P2D_WORLD_CHUNK_NODES];
+};
+
+static struct p2d_world_node *_p2d_pool_take(struct p2d_world_pool *pool) {
+    if(pool->current == NULL || pool->current->used == P2D_WORLD_CHUNK_NODES) {
+        struct p2d_world_chunk *next = pool->current ? pool->current->next : pool->head;
+
+        if(next == NULL) {
+            next = p2d_alloc(sizeof(struct p2d_world_chunk));
+            if(next == NULL) {
+                return NULL;
+            }
+
+            if(pool->current) {
+                pool->current->next = next;
+            } else {
+                pool->head = next;
+            }
+        }
+
+        next->used = 0;
+        pool->current = next;
+    }
+
+    return &pool->current->nodes[pool->current->used++];
+}
+
+// every node goes back to the pool, the chunks are reused
+static void _p2d_pool_reset(struct p2d_world_pool *pool) {
+    pool->current = NULL;
+}
+
+static void _p2d_pool_free(struct p2d_world_pool *pool) {
+    struct p2d_world_chunk *chunk = pool->head;
+    while(chunk != NULL) {
+        struct p2d_world_chunk *next = chunk->next;
+        p2d_free(chunk, sizeof(struct p2d_world_chunk));
+        chunk = next;
+    }
+    *pool = (struct p2d_world_pool){0};
+}
 
 int p2d_world_hash(int tile_x, int tile_y) {
-    int hash_x = tile_x * 73856093;
-    int hash_y = tile_y * 19349663;
-    int hash = (hash_x + hash_y) % P2D_MAX_OBJECTS;
+    // wrapped in unsigned, which signed overflow isn't allowed to do (same bits, so same buckets)
+    unsigned int hash_x = (unsigned int)tile_x * 73856093u;
+    unsigned int hash_y = (unsigned int)tile_y * 19349663u;
+    int hash = (int)(hash_x + hash_y) % p2d_state.p2d_bucket_count;
     if(hash < 0)
-        hash += P2D_MAX_OBJECTS;
+        hash += p2d_state.p2d_bucket_count;
 
     return hash;
 }
 
-void p2d_world_insert(int world_hash, struct p2d_object *object) {
-    if(object == NULL) {
-        p2d_logf(P2D_LOG_ERROR, "p2d_world_insert: object is NULL.\n");
-        return;
+bool p2d_world_reserve(int buckets) {
+    if(buckets < P2D_MIN_BUCKETS) {
+        buckets = P2D_MIN_BUCKETS;
     }
 
-    int index = world_hash;
+    int old_count = p2d_state.p2d_bucket_count;
+    if(buckets <= old_count) {
+        return true;
+    }
+
+    // world, resting, static and culled heads, plus the used list (old and new are held at once)
+    size_t per_bucket = 4 * sizeof(struct p2d_world_node *) + sizeof(int) + sizeof(bool);
+    if(!p2d_memory_fits((size_t)buckets * per_bucket)) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_world_reserve: %d buckets do not fit in the memory budget.\n", buckets);
+        return false;
+    }
+
+    // the tables are about to be rehashed anyway
+    p2d_world_remove_all();
+    p2d_world_remove_all_resting();
+    p2d_world_remove_all_statics();
+
+    size_t old_buckets = (size_t)old_count;
+    size_t new_buckets = (size_t)buckets;
+
+    const struct p2d_column columns[] = {
+        {(void **)&p2d_world, sizeof(*p2d_world)},
+        {(void **)&p2d_world_resting, sizeof(*p2d_world_resting)},
+        {(void **)&p2d_broadphase.statics, sizeof(*p2d_broadphase.statics)},
+        {(void **)&p2d_world_used, sizeof(*p2d_world_used)},
+        {(void **)&p2d_broadphase.used_listed, sizeof(*p2d_broadphase.used_listed)}
+    };
+    if(!p2d_grow_columns(columns, (int)(sizeof(columns) / sizeof(columns[0])), old_buckets, new_buckets)) {
+        // still the old size, but emptied
+        p2d_world_mark_resting_dirty();
+        p2d_world_mark_statics_dirty();
+        return false;
+    }
+
+    p2d_state.p2d_bucket_count = buckets;
+
+    // culled objects are keyed by world hash too
+    if(!p2d_rehash_culled_objects(old_count)) {
+        return false;
+    }
+
+    p2d_world_mark_resting_dirty();
+    p2d_world_mark_statics_dirty();
+    return true;
+}
+
+static void _p2d_free_tile_lists(void);
+
+void p2d_world_shutdown(void) {
+    _p2d_free_tile_lists();
+    _p2d_pool_free(&p2d_broadphase.nodes);
+    _p2d_pool_free(&p2d_broadphase.resting_nodes);
+    _p2d_pool_free(&p2d_broadphase.static_nodes);
 
-    struct p2d_world_node *node = malloc(sizeof(struct p2d_world_node));
-    node->object = object;
+    size_t buckets = (size_t)p2d_state.p2d_bucket_count;
+    p2d_free(p2d_world, buckets * sizeof(*p2d_world));
+    p2d_free(p2d_world_resting, buckets * sizeof(*p2d_world_resting));
+    p2d_free(p2d_broadphase.statics, buckets * sizeof(*p2d_broadphase.statics));
+    p2d_free(p2d_world_used, buckets * sizeof(*p2d_world_used));
+    p2d_free(p2d_broadphase.used_listed, buckets * sizeof(*p2d_broadphase.used_listed));
+
+    p2d_world = NULL;
+    p2d_world_resting = NULL;
+    p2d_broadphase.statics = NULL;
+    p2d_world_used = NULL;
+    p2d_broadphase.used_listed = NULL;
+    p2d_world_used_count = 0;
+    p2d_state.p2d_bucket_count = 0;
+    p2d_state.p2d_world_node_count = 0;
+    p2d_broadphase.resting_dirty = false;
+    p2d_broadphase.statics_dirty = false;
+}
+
+static bool _p2d_world_link(int index, int body) {
+    struct p2d_world_node *node = _p2d_pool_take(&p2d_broadphase.nodes);
+    if(node == NULL) {
+        p2d_broadphase.link_failed = true;
+        return false;
+    }
+
+    node->object = p2d_objects[body];
+    node->handle = p2d_bodies.handle[body];
     node->next = p2d_world[index];
     if(p2d_world[index] == NULL) // track new buckets
         p2d_state.p2d_world_node_count++;
     p2d_world[index] = node;
+
+    if(!p2d_broadphase.used_listed[index]) {
+        p2d_broadphase.used_listed[index] = true;
+        p2d_world_used[p2d_world_used_count++] = index;
+    }
+    return true;
+}
+
+bool p2d_world_insert(int world_hash, struct p2d_object *object) {
+    if(object == NULL) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_world_insert: object is NULL.\n");
+        return false;
+    }
+
+    int body = p2d_body_index(object->handle);
+    if(body < 0) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_world_insert: object is not registered.\n");
+        return false;
+    }
+
+    return _p2d_world_link(world_hash, body);
 }
 
 void p2d_world_remove(int world_hash, struct p2d_object *object) {
@@ -55,15 +202,14 @@ void p2d_world_remove(int world_hash, struct p2d_object *object) {
     bool was_first = true;
 
     while(node != NULL) {
-        if(node->object == object) {
+        if(node->handle == object->handle) {
+            // the node itself goes back to the pool on the next p2d_world_remove_all()
             if(prev == NULL) {
                 p2d_world[index] = node->next;
             } else {
                 prev->next = node->next;
             }
 
-            free(node);
-            
             // Only decrement if we removed the last node in this bucket
             if(p2d_world[index] == NULL && was_first) {
                 p2d_state.p2d_world_node_count--;
@@ -77,47 +223,308 @@ void p2d_world_remove(int world_hash, struct p2d_object *object) {
 }
 
 void p2d_world_remove_all(void) {
-    for(int i = 0; i < P2D_MAX_OBJECTS; i++) {
-        struct p2d_world_node *node = p2d_world[i];
-        while(node != NULL) {
-            struct p2d_world_node *next = node->next;
-            free(node);
-            node = next;
-        }
-        p2d_world[i] = NULL;
+    // only buckets that were used need clearing
+    for(int i = 0; i < p2d_world_used_count; i++) {
+        int index = p2d_world_used[i];
+        p2d_world[index] = NULL;
+        p2d_broadphase.used_listed[index] = false;
     }
+    p2d_world_used_count = 0;
+    _p2d_pool_reset(&p2d_broadphase.nodes);
     p2d_state.p2d_world_node_count = 0;
     // p2d_state.p2d_object_count = 0;
 }
 
+void p2d_world_remove_all_resting(void) {
+    for(int i = 0; i < p2d_state.p2d_bucket_count; i++) {
+        p2d_world_resting[i] = NULL;
+    }
+    _p2d_pool_reset(&p2d_broadphase.resting_nodes);
+    p2d_broadphase.resting_dirty = false;
+}
+
+void p2d_world_mark_resting_dirty(void) {
+    p2d_broadphase.resting_dirty = true;
+}
+
+void p2d_world_remove_all_statics(void) {
+    for(int i = 0; p2d_broadphase.statics && i < p2d_state.p2d_bucket_count; i++) {
+        p2d_broadphase.statics[i] = NULL;
+    }
+    _p2d_pool_reset(&p2d_broadphase.static_nodes);
+    p2d_broadphase.statics_dirty = false;
+}
+
+void p2d_world_mark_statics_dirty(void) {
+    p2d_broadphase.statics_dirty = true;
+}
+
+static void _p2d_static_link(int body, int hash) {
+    struct p2d_world_node *node = _p2d_pool_take(&p2d_broadphase.static_nodes);
+    if(node == NULL) {
+        // try the whole table again next rebuild
+        p2d_broadphase.statics_dirty = true;
+        p2d_broadphase.link_failed = true;
+        return;
+    }
+
+    node->object = p2d_objects[body];
+    node->handle = p2d_bodies.handle[body];
+    node->next = p2d_broadphase.statics[hash];
+    p2d_broadphase.statics[hash] = node;
+}
+
+void p2d_world_insert_static(int body, int tile_x, int tile_y) {
+    _p2d_static_link(body, p2d_world_hash(tile_x, tile_y));
+}
+
+static void _register_static_tiles(struct p2d_object *object, int hash) {
+    _p2d_static_link(p2d_body_index(object->handle), hash);
+}
+
+static void _p2d_rebuild_static_world(void) {
+    p2d_world_remove_all_statics();
+
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        uint8_t flags = p2d_bodies.flags[i];
+        if(!(flags & P2D_BODY_STATIC) || (flags & (P2D_BODY_CULLED | P2D_BODY_INACTIVE))) {
+            continue;
+        }
+
+        struct p2d_object proxy;
+        p2d_body_proxy(i, &proxy);
+
+        struct p2d_aabb aabb = p2d_get_aabb(&proxy);
+        p2d_bodies.aabb[i] = aabb;
+
+        p2d_for_each_tile_in_aabb(&proxy, aabb, _register_static_tiles);
+    }
+}
+
+static void _register_resting_tiles(struct p2d_object *object, int hash) {
+    struct p2d_world_node *node = _p2d_pool_take(&p2d_broadphase.resting_nodes);
+    if(node == NULL) {
+        p2d_broadphase.resting_dirty = true;
+        p2d_broadphase.link_failed = true;
+        return;
+    }
+
+    node->object = p2d_objects[p2d_body_index(object->handle)];
+    node->handle = object->handle;
+    node->next = p2d_world_resting[hash];
+    p2d_world_resting[hash] = node;
+}
+
+static void _p2d_rebuild_resting_world(void) {
+    p2d_world_remove_all_resting();
+
+    for(int i = 0; i < p2d_bodies.count; i++) {
+        uint8_t flags = p2d_bodies.flags[i];
+        if(!(flags & P2D_BODY_SLEEPING)) {
+            continue;
+        }
+
+        if(flags & (P2D_BODY_CULLED | P2D_BODY_INACTIVE)) {
+            continue;
+        }
+
+        // sleeping bodies don't move, their bounds from the start of the step still hold
+        struct p2d_object proxy;
+        p2d_body_proxy(i, &proxy);
+        p2d_for_each_tile_in_aabb(&proxy, p2d_bodies.aabb[i], _register_resting_tiles);
+    }
+}
+
+// refresh the bounds of [begin, end) and hand each body's tiles to callback, returns how many were asleep
+static int _p2d_register_range(int begin, int end, void (*callback)(struct p2d_object *object, int hash)) {
+    int sleeping = 0;
+
+    for(int i = begin; i < end; i++) {
+        uint8_t flags = p2d_bodies.flags[i];
+        if(flags & P2D_BODY_INACTIVE) {
+            continue;
+        }
+
+        // outside every activation region (decided once per step in p2d_update_regions)
+        if(flags & P2D_BODY_CULLED) {
+            continue;
+        }
+
+        // at rest, lives in the resting table instead
+        if(flags & P2D_BODY_SLEEPING) {
+            sleeping++;
+            continue;
+        }
+
+        // never moves, lives in the static table
+        if(flags & P2D_BODY_STATIC) {
+            continue;
+        }
+
+        struct p2d_object proxy;
+        p2d_body_proxy(i, &proxy);
+
+        struct p2d_aabb aabb = p2d_get_aabb(&proxy);
+        p2d_bodies.aabb[i] = aabb;
+
+        p2d_for_each_tile_in_aabb(&proxy, aabb, callback);
+    }
+
+    return sleeping;
+}
+
+//
+// PARALLEL REBUILD
+//
+
 /*
-    TODO: further optimize, static objs never move
+    Each job thread finds the tiles of its ranges into its own list, then they are inserted
+    serially in body order, so the tables come out exactly as a serial rebuild leaves them.
+*/
+static P2D_THREAD_LOCAL struct p2d_tile_list *collecting = NULL;
+
+static void _p2d_collect_tile(struct p2d_object *object, int hash) {
+    struct p2d_tile_list *list = collecting;
+    if(list->failed || !p2d_grow((void **)&list->tiles, &list->capacity, list->count + 2, sizeof(int))) {
+        list->failed = true;
+        return;
+    }
+
+    list->tiles[list->count++] = p2d_body_index(object->handle);
+    list->tiles[list->count++] = hash;
+}
+
+static void _p2d_collect_range(void *data, int begin, int end, int thread) {
+    struct p2d_tile_list *list = &p2d_broadphase.tile_lists[thread];
+    (void)data;
+
+    if(list->failed || !p2d_grow((void **)&list->spans, &list->span_capacity, list->span_count + 1, sizeof(struct p2d_tile_span))) {
+        list->failed = true;
+        return;
+    }
+
+    struct p2d_tile_span *span = &list->spans[list->span_count++];
+    span->begin = begin;
+    span->thread = thread;
+    span->first = list->count;
 
-    see TODO in README.md, we can just not bother to create the world until ready
+    collecting = list;
+    list->sleeping += _p2d_register_range(begin, end, _p2d_collect_tile);
+    collecting = NULL;
+
+    span->count = list->count - span->first;
+}
+
+static int _p2d_compare_spans(const void *a, const void *b) {
+    const struct p2d_tile_span *sa = a;
+    const struct p2d_tile_span *sb = b;
+    return (sa->begin > sb->begin) - (sa->begin < sb->begin);
+}
+
+static bool _p2d_rebuild_world_parallel(void) {
+    int threads = p2d_jobs_thread_count();
+    for(int t = 0; t < threads; t++) {
+        struct p2d_tile_list *list = &p2d_broadphase.tile_lists[t];
+        list->count = 0;
+        list->span_count = 0;
+        list->sleeping = 0;
+        list->failed = false;
+    }
+
+    p2d_parallel_for(p2d_bodies.count, P2D_JOB_GRAIN, _p2d_collect_range, NULL);
+
+    int spans = 0;
+    for(int t = 0; t < threads; t++) {
+        if(p2d_broadphase.tile_lists[t].failed) {
+            return false;
+        }
+        spans += p2d_broadphase.tile_lists[t].span_count;
+    }
+
+    if(!p2d_grow((void **)&p2d_broadphase.merged_spans, &p2d_broadphase.merged_capacity, spans, sizeof(struct p2d_tile_span))) {
+        return false;
+    }
+
+    struct p2d_tile_span *merged = p2d_broadphase.merged_spans;
+    int merged_count = 0;
+    for(int t = 0; t < threads; t++) {
+        struct p2d_tile_list *list = &p2d_broadphase.tile_lists[t];
+        for(int k = 0; k < list->span_count; k++) {
+            merged[merged_count++] = list->spans[k];
+        }
+        p2d_state.p2d_sleeping_count += list->sleeping;
+    }
+
+    // back in body order, whichever thread ran each range
+    qsort(merged, (size_t)merged_count, sizeof(struct p2d_tile_span), _p2d_compare_spans);
+
+    for(int k = 0; k < merged_count; k++) {
+        int *tiles = &p2d_broadphase.tile_lists[merged[k].thread].tiles[merged[k].first];
+
+        for(int n = 0; n < merged[k].count; n += 2) {
+            _p2d_world_link(tiles[n + 1], tiles[n]);
+        }
+    }
+
+    return true;
+}
+
+static void _p2d_free_tile_lists(void) {
+    for(int t = 0; t < P2D_MAX_THREADS; t++) {
+        p2d_free(p2d_broadphase.tile_lists[t].tiles, (size_t)p2d_broadphase.tile_lists[t].capacity * sizeof(*p2d_broadphase.tile_lists[t].tiles));
+        p2d_free(p2d_broadphase.tile_lists[t].spans, (size_t)p2d_broadphase.tile_lists[t].span_capacity * sizeof(*p2d_broadphase.tile_lists[t].spans));
+        p2d_broadphase.tile_lists[t] = (struct p2d_tile_list){0};
+    }
+
+    p2d_free(p2d_broadphase.merged_spans, (size_t)p2d_broadphase.merged_capacity * sizeof(*p2d_broadphase.merged_spans));
+    p2d_broadphase.merged_spans = NULL;
+    p2d_broadphase.merged_capacity = 0;
+}
+
+// keep about one bucket per body as the body store grows (tried once per growth, over budget it stays smaller)
+void p2d_world_fit_bodies(void) {
+    if(p2d_state.p2d_bucket_count < p2d_bodies.capacity && p2d_broadphase.reserve_attempted != p2d_bodies.capacity) {
+        p2d_broadphase.reserve_attempted = p2d_bodies.capacity;
+        p2d_world_reserve(p2d_bodies.capacity);
+    }
+}
+
+/*
+    Awake objects are registered again every substep, the resting and static tables only when they changed
 */
-void p2d_rebuild_world(void) {
+bool p2d_rebuild_world(void) {
+    p2d_world_fit_bodies();
+
     p2d_world_remove_all();
+    p2d_broadphase.link_failed = false;
 
     p2d_state.p2d_sleeping_count = 0;
 
-    for(int i = 0; i < P2D_MAX_OBJECTS; i++) {
-        struct p2d_object *object = p2d_objects[i];
-        if(object != NULL) {
-            if(object->in_active && !*object->in_active) {
-                continue;
-            }
-
-            // frustum
-            if(p2d_state.p2d_frustum_sleeping) {
-                if(!p2d_obb_intersects_obb(p2d_state.p2d_frustum, p2d_get_obb(object))) {
-                    p2d_state.p2d_sleeping_count++;
-                    object->sleeping = true;
-                    continue;
-                }
-                object->sleeping = false;
-            } // NOTE: this makes frustum sleeping INCOMPATIBLE with future sleeping!
-
-            p2d_for_each_intersecting_tile(object, _register_intersecting_tiles);
+    bool registered = false;
+    if(p2d_jobs_parallel(p2d_bodies.count, P2D_JOB_GRAIN)) {
+        registered = _p2d_rebuild_world_parallel();
+        if(!registered) {
+            p2d_logf(P2D_LOG_WARN, "p2d_rebuild_world: out of scratch memory, rebuilding serially.\n");
+            p2d_world_remove_all();
+            p2d_state.p2d_sleeping_count = 0;
         }
     }
+
+    if(!registered) {
+        p2d_state.p2d_sleeping_count = _p2d_register_range(0, p2d_bodies.count, _register_intersecting_tiles);
+    }
+
+    if(p2d_broadphase.resting_dirty) {
+        _p2d_rebuild_resting_world();
+    }
+
+    if(p2d_broadphase.statics_dirty) {
+        _p2d_rebuild_static_world();
+    }
+
+    if(p2d_broadphase.link_failed) {
+        p2d_logf(P2D_LOG_ERROR, "p2d_rebuild_world: out of memory for nodes, some bodies are missing from the broad phase.\n");
+        return false;
+    }
+    return true;
 }
@@ -0,0 +1,62 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Compiles against p2d.h the way code written before world contexts did: p2d_state is a plain
+    variable and struct tags are usable as is. Also checks the library's internal short names
+    don't leak out, and that p2d_state is the default world's state.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <p2d/p2d.h>
+
+#if defined(p2d_state) || defined(p2d_events) || defined(p2d_regions) || defined(p2d_solver) || \
+    defined(p2d_queries) || defined(p2d_triggers) || defined(p2d_broadphase) || defined(p2d_narrowphase)
+    #error "internal names leaked out of p2d.h"
+#endif
+
+static void quiet_log(int level, const char *fmt, ...) {
+    (void)level;
+    (void)fmt;
+}
+
+static float gravity_of(const struct p2d_state *state) {
+    return state->p2d_gravity.y;
+}
+
+int main(void) {
+    if(!p2d_init(64, NULL, NULL, quiet_log)) {
+        printf("failed to init\n");
+        return 1;
+    }
+    p2d_state.p2d_gravity = (vec2_t){{0, 60.0f}};
+
+    struct p2d_state copy = p2d_state;
+    struct p2d_broadphase_store *broadphase = &p2d_get_world()->broadphase;
+    struct p2d_narrowphase_store *narrowphase = &p2d_get_world()->narrowphase;
+
+    bool ok = gravity_of(&copy) == 60.0f && p2d_get_world()->state == &p2d_state && broadphase && narrowphase;
+
+    // another world has its own state, p2d_state stays the default world's
+    p2d_world_t *world = p2d_world_create(32, NULL, NULL, quiet_log, NULL);
+    if(!world) {
+        printf("failed to create a world\n");
+        return 1;
+    }
+    p2d_world_t *previous = p2d_world_use(world);
+    ok = ok && p2d_get_world()->state != &p2d_state && p2d_get_world()->state->p2d_cell_size == 32;
+    p2d_world_use(previous);
+    ok = ok && p2d_state.p2d_cell_size == 64;
+    p2d_world_destroy(world);
+
+    p2d_shutdown();
+
+    printf(ok ? "compat ok\n" : "compat FAILED\n");
+    return ok ? 0 : 1;
+}
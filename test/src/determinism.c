@@ -0,0 +1,204 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Runs the same scene in deterministic mode under different settings (threads, capacity,
+    cell size) and checks the state after every step is bit for bit the same as the first run's,
+    and that the running state hash agrees with hashing the world from scratch.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <p2d/p2d.h>
+
+#define BODIES 240
+#define COLUMNS 40
+#define JOINTS 12
+#define STEPS 240
+
+struct run_config {
+    const char *name;
+    int cell_size;
+    int threads;
+    int capacity;
+};
+
+static struct p2d_object objects[BODIES + 2];
+static struct p2d_joint joints[JOINTS];
+static uint64_t hashes[STEPS];
+static uint64_t step_hashes[STEPS];
+static int triggers = 0;
+
+static void quiet_log(int level, const char *fmt, ...) {
+    (void)level;
+    (void)fmt;
+}
+
+static void on_trigger(struct p2d_cb_data *data) {
+    (void)data;
+    triggers++;
+}
+
+// FNV-1a over the raw bits, so -0.0 vs 0.0 or a different NaN counts as a difference
+static uint64_t hash_floats(uint64_t hash, const float *values, int count) {
+    const unsigned char *bytes = (const unsigned char *)values;
+    for(size_t i = 0; i < (size_t)count * sizeof(float); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hash_world(void) {
+    uint64_t hash = 14695981039346656037ull;
+    for(int i = 0; i < BODIES + 2; i++) {
+        struct p2d_object *o = &objects[i];
+        float state[6] = {o->x, o->y, o->rotation, o->vx, o->vy, o->vr};
+        hash = hash_floats(hash, state, 6);
+    }
+    return hash;
+}
+
+static void build_scene(void) {
+    memset(objects, 0, sizeof(objects));
+    memset(joints, 0, sizeof(joints));
+
+    objects[0] = (struct p2d_object){
+        .type = P2D_OBJECT_RECTANGLE, .is_static = true, .x = 0, .y = 1000,
+        .rectangle = {.width = 2400, .height = 40},
+        .density = 1, .restitution = .5f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+    };
+    p2d_create_object(&objects[0]);
+
+    // a sensor the pile falls through
+    objects[1] = (struct p2d_object){
+        .type = P2D_OBJECT_RECTANGLE, .is_static = true, .is_trigger = true, .x = 400, .y = 600,
+        .rectangle = {.width = 600, .height = 30}, .mask = 0xFFFF
+    };
+    p2d_create_object(&objects[1]);
+
+    for(int i = 0; i < BODIES; i++) {
+        struct p2d_object *o = &objects[i + 2];
+        bool box = (i % 3) != 0;
+
+        *o = (struct p2d_object){
+            .type = box ? P2D_OBJECT_RECTANGLE : P2D_OBJECT_CIRCLE,
+            .x = 30.0f + (float)(i % COLUMNS) * 55.0f + (float)((i / COLUMNS) * 7 % 20),
+            .y = 900.0f - (float)(i / COLUMNS) * 60.0f,
+            .vx = (float)((i * 37) % 11) - 5.0f,
+            .density = 2, .restitution = .3f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+        };
+        if(box) {
+            o->rectangle.width = 36;
+            o->rectangle.height = 36;
+        }
+        else {
+            o->circle.radius = 18;
+        }
+        p2d_create_object(o);
+    }
+
+    for(int j = 0; j < JOINTS; j++) {
+        int a = 2 + j * 17 % (BODIES - COLUMNS);
+        joints[j] = (struct p2d_joint){
+            .type = P2D_JOINT_SPRING, .a = &objects[a], .b = &objects[a + COLUMNS], .bias_factor = 0.2f,
+            .spring_joint = {.rest_length = 60, .spring_constant = 0.5f}
+        };
+        p2d_add_joint(&joints[j]);
+    }
+}
+
+static bool run(const struct run_config *config, bool reference) {
+    struct p2d_capacity capacity = {.objects = config->capacity};
+    if(!p2d_init_with_capacity(config->cell_size, NULL, on_trigger, quiet_log, &capacity)) {
+        printf("%-16s failed to init\n", config->name);
+        return false;
+    }
+    p2d_state.p2d_gravity = (vec2_t){{0, 60.0f}};
+    p2d_state.p2d_deterministic = true;
+    p2d_state.p2d_state_hashing = true;
+
+    if(config->threads > 1) {
+        p2d_jobs_init(config->threads);
+    }
+
+    triggers = 0;
+    build_scene();
+
+    int first_mismatch = -1;
+    int first_stale = -1;
+    for(int step = 0; step < STEPS; step++) {
+        // churn the dense body order the same way on every run
+        if(step == STEPS / 3) {
+            for(int i = 2; i < 2 + BODIES; i += 9) {
+                bool jointed = false;
+                for(int j = 0; j < JOINTS; j++) {
+                    jointed |= joints[j].a == &objects[i] || joints[j].b == &objects[i];
+                }
+                if(!jointed) {
+                    p2d_remove_object(&objects[i]);
+                    objects[i].y -= 500.0f;
+                    p2d_create_object(&objects[i]);
+                }
+            }
+        }
+
+        p2d_step(1.0f / 60.0f);
+
+        uint64_t hash = hash_world();
+        uint64_t step_hash = p2d_state.p2d_step_hash;
+        if(reference) {
+            hashes[step] = hash;
+            step_hashes[step] = step_hash;
+        }
+        else if((hash != hashes[step] || step_hash != step_hashes[step]) && first_mismatch < 0) {
+            first_mismatch = step;
+        }
+
+        // the running hash only rehashes what moved, it has to agree with hashing everything
+        if(step_hash != p2d_state_hash() && first_stale < 0) {
+            first_stale = step;
+        }
+    }
+
+    printf("%-16s hash %016llx state hash %016llx triggers %d", config->name,
+        (unsigned long long)hash_world(), (unsigned long long)p2d_state.p2d_step_hash, triggers);
+    if(first_mismatch >= 0) {
+        printf("  MISMATCH from step %d", first_mismatch);
+    }
+    if(first_stale >= 0) {
+        printf("  STALE state hash from step %d", first_stale);
+    }
+    printf(first_mismatch < 0 && first_stale < 0 ? "  ok\n" : "\n");
+
+    p2d_shutdown();
+    p2d_jobs_shutdown();
+    return first_mismatch < 0 && first_stale < 0;
+}
+
+int main(void) {
+    const struct run_config configs[] = {
+        {"reference",        100, 1, 0},
+        {"again",            100, 1, 0},
+        {"4 threads",        100, 4, 0},
+        {"3 threads",        100, 3, 0},
+        {"big capacity",     100, 1, 4096},
+        {"small cells",       48, 1, 0},
+        {"cells + threads",   48, 4, 4096},
+    };
+    int count = (int)(sizeof(configs) / sizeof(configs[0]));
+
+    bool ok = true;
+    for(int i = 0; i < count; i++) {
+        ok &= run(&configs[i], i == 0);
+    }
+
+    printf(ok ? "deterministic\n" : "NOT deterministic\n");
+    return ok ? 0 : 1;
+}
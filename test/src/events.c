@@ -0,0 +1,244 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Checks for the per step event buffer and trigger tracking.
+
+    Drops a row of boxes on a floor and checks every step reports each touching pair once, with
+    the lower handle first, and calls on_collision once per collision event. Then sends a ball
+    through a trigger zone (next to a ball that never reaches it) and checks it gets exactly one
+    enter and one exit, stays in between, isn't pushed by the zone, and that a ball resting in the
+    zone keeps overlapping until it is removed, without an exit.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <p2d/p2d.h>
+
+#define BOXES 10
+#define STEPS 300
+
+static struct p2d_object floor_box;
+static struct p2d_object boxes[BOXES];
+
+static struct p2d_object zone;
+static struct p2d_object crossing;
+static struct p2d_object control;
+static struct p2d_object resting;
+
+static int collision_calls = 0;
+static int trigger_calls = 0;
+
+static void quiet_log(int level, const char *fmt, ...) {
+    (void)level;
+    (void)fmt;
+}
+
+static void on_collision(struct p2d_cb_data *data) {
+    (void)data;
+    collision_calls++;
+}
+
+static void on_trigger(struct p2d_cb_data *data) {
+    (void)data;
+    trigger_calls++;
+}
+
+static bool same_pair(const struct p2d_event *event, const struct p2d_object *a, const struct p2d_object *b) {
+    return (event->a == a && event->b == b) || (event->a == b && event->b == a);
+}
+
+// one event per pair, lower handle first, objects matching their handles
+static bool check_events(int step) {
+    int count;
+    const struct p2d_event *events = p2d_get_events(&count);
+
+    for(int i = 0; i < count; i++) {
+        const struct p2d_event *e = &events[i];
+        if(e->handle_a >= e->handle_b || e->a->handle != e->handle_a || e->b->handle != e->handle_b) {
+            printf("step %d: event %d has its pair out of order\n", step, i);
+            return false;
+        }
+        for(int j = i + 1; j < count; j++) {
+            if(events[j].handle_a == e->handle_a && events[j].handle_b == e->handle_b) {
+                printf("step %d: pair %d, %d was reported twice\n", step, e->handle_a, e->handle_b);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool check_collisions(void) {
+    p2d_init(64, on_collision, on_trigger, quiet_log);
+    p2d_state.p2d_gravity = (vec2_t){{0, 60.0f}};
+    p2d_state.p2d_substeps = 8;
+
+    floor_box = (struct p2d_object){
+        .type = P2D_OBJECT_RECTANGLE, .is_static = true, .x = -500, .y = 200,
+        .rectangle = {.width = 1000, .height = 40},
+        .density = 1, .restitution = .3f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+    };
+    p2d_create_object(&floor_box);
+
+    for(int i = 0; i < BOXES; i++) {
+        boxes[i] = (struct p2d_object){
+            .type = P2D_OBJECT_RECTANGLE, .x = -250.0f + (float)i * 42.0f, .y = 150.0f - (float)(i % 3) * 20.0f,
+            .rectangle = {.width = 40, .height = 40},
+            .density = 1, .restitution = .1f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+        };
+        p2d_create_object(&boxes[i]);
+    }
+
+    bool ok = true;
+    int collisions = 0;
+    for(int step = 0; step < STEPS && ok; step++) {
+        collision_calls = 0;
+        trigger_calls = 0;
+        p2d_step(1.0f / 60.0f);
+        ok = check_events(step);
+
+        int count;
+        const struct p2d_event *events = p2d_get_events(&count);
+        int step_collisions = 0;
+        for(int i = 0; i < count; i++) {
+            if(events[i].type != P2D_EVENT_COLLISION) {
+                printf("step %d: trigger event without a trigger\n", step);
+                ok = false;
+            }
+            else if(events[i].contact_count < 1 || events[i].contact_count > 2 || events[i].impulse < 0.0f) {
+                printf("step %d: collision event with %d contacts and impulse %f\n", step, events[i].contact_count, events[i].impulse);
+                ok = false;
+            }
+            step_collisions++;
+        }
+        if(collision_calls != step_collisions || trigger_calls != 0) {
+            printf("step %d: %d collision events but %d on_collision calls\n", step, step_collisions, collision_calls);
+            ok = false;
+        }
+        collisions += step_collisions;
+    }
+
+    if(ok && collisions == 0) {
+        printf("the boxes never reported landing\n");
+        ok = false;
+    }
+
+    p2d_shutdown();
+    return ok;
+}
+
+static bool check_triggers(void) {
+    p2d_init(64, on_collision, on_trigger, quiet_log);
+    p2d_state.p2d_gravity = (vec2_t){{0, 0}};
+    p2d_state.p2d_substeps = 8;
+
+    // straddles the origin, so it sits in tiles on both sides of zero
+    zone = (struct p2d_object){
+        .type = P2D_OBJECT_RECTANGLE, .is_static = true, .is_trigger = true, .x = -100, .y = -100,
+        .rectangle = {.width = 200, .height = 200}, .density = 1, .mask = 0xFFFF
+    };
+    crossing = (struct p2d_object){
+        .type = P2D_OBJECT_CIRCLE, .x = -200, .y = 0, .vx = 100,
+        .circle = {.radius = 10}, .density = 1, .mask = 0xFFFF
+    };
+    control = crossing;
+    control.y = 400;
+    resting = (struct p2d_object){
+        .type = P2D_OBJECT_CIRCLE, .x = -50, .y = -50,
+        .circle = {.radius = 10}, .density = 1, .mask = 0xFFFF
+    };
+    p2d_create_object(&zone);
+    p2d_create_object(&crossing);
+    p2d_create_object(&control);
+    p2d_create_object(&resting);
+
+    bool ok = true;
+    int enters = 0, stays = 0, exits = 0, overlapping = 0, resting_enters = 0, calls = 0;
+    for(int step = 0; step < STEPS && ok; step++) {
+        trigger_calls = 0;
+        p2d_step(1.0f / 60.0f);
+        ok = check_events(step);
+
+        int count;
+        const struct p2d_event *events = p2d_get_events(&count);
+        int dispatched = 0;
+        for(int i = 0; i < count; i++) {
+            const struct p2d_event *e = &events[i];
+            if(e->type == P2D_EVENT_COLLISION) {
+                printf("step %d: the trigger zone collided\n", step);
+                ok = false;
+            }
+            if(e->type != P2D_EVENT_TRIGGER_STAY) {
+                dispatched++;
+            }
+
+            if(same_pair(e, &zone, &crossing)) {
+                enters += e->type == P2D_EVENT_TRIGGER_ENTER;
+                stays += e->type == P2D_EVENT_TRIGGER_STAY;
+                exits += e->type == P2D_EVENT_TRIGGER_EXIT;
+            }
+            else if(same_pair(e, &zone, &resting)) {
+                resting_enters += e->type == P2D_EVENT_TRIGGER_ENTER;
+                if(e->type == P2D_EVENT_TRIGGER_EXIT) {
+                    printf("step %d: the resting ball left the zone\n", step);
+                    ok = false;
+                }
+            }
+        }
+        if(trigger_calls != dispatched) {
+            printf("step %d: %d enters and exits but %d on_trigger calls\n", step, dispatched, trigger_calls);
+            ok = false;
+        }
+        calls += trigger_calls;
+
+        // overlap only, so the ball goes through exactly like the one that misses the zone
+        if(crossing.x != control.x || crossing.vx != control.vx || crossing.y != 0.0f || crossing.vy != 0.0f) {
+            printf("step %d: the zone pushed the ball\n", step);
+            ok = false;
+        }
+
+        bool inside = p2d_trigger_overlapping(&zone, &crossing);
+        overlapping += inside;
+        if(inside != (enters == 1 && exits == 0)) {
+            printf("step %d: overlap set disagrees with the enter and exit events\n", step);
+            ok = false;
+        }
+    }
+
+    if(ok && (enters != 1 || exits != 1 || stays != overlapping - 1 || resting_enters != 1 || calls != 3)) {
+        printf("crossing: %d enters, %d stays, %d exits over %d steps, resting: %d enters\n", enters, stays, exits, overlapping, resting_enters);
+        ok = false;
+    }
+
+    // removing drops the overlap without an exit
+    if(ok) {
+        p2d_remove_object(&resting);
+        int count;
+        p2d_get_trigger_overlaps(&count);
+
+        trigger_calls = 0;
+        p2d_step(1.0f / 60.0f);
+        if(count != 0 || trigger_calls != 0) {
+            printf("removed ball: %d overlaps left, %d on_trigger calls\n", count, trigger_calls);
+            ok = false;
+        }
+    }
+
+    p2d_shutdown();
+    return ok;
+}
+
+int main(void) {
+    bool ok = check_collisions();
+    ok = check_triggers() && ok;
+
+    printf(ok ? "events ok\n" : "events FAILED\n");
+    return ok ? 0 : 1;
+}
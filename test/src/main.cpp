@@ -651,8 +651,9 @@ int main(int argc, char** argv) {
     p2d_state.out_contacts = last_contacts;
 
     p2d_state.p2d_gravity = (vec2_t){.x = 0, .y = 60.0f};
-    // p2d_state.p2d_frustum_sleeping = true;
-    // p2d_state.p2d_frustum = (struct p2d_obb){.x = (1920 - 1280) / 2, .y = (1080 - 720) / 2, .w = 1280, .h = 720};
+    struct p2d_aabb view = {.x = (1920 - 1280) / 2, .y = (1080 - 720) / 2, .w = 1280, .h = 720};
+    // p2d_state.p2d_region_sleeping = true;
+    // p2d_add_region(view);
 
     p2d_state.on_trigger = trigger_callback;
     p2d_state.on_collision = collision_callback;
@@ -747,7 +748,7 @@ int main(int argc, char** argv) {
 
         // // next, draw pink tile rects for non-empty tiles
         // // we have to recompute (ok for demo) because we cant reverse hash
-        // for(int i = 0; i < P2D_MAX_OBJECTS; i++) {
+        // for(int i = 0; i < p2d_state.p2d_object_count; i++) {
         //     if(p2d_objects[i] == NULL) {
         //         continue;
         //     }
@@ -818,15 +819,16 @@ int main(int argc, char** argv) {
             SDL_RenderLine(renderer, world_anchor_a.x, world_anchor_a.y, world_anchor_b.x, world_anchor_b.y);
         }
 
-        // draw frustum
-        if(p2d_state.p2d_frustum_sleeping) {
+        // draw activation region
+        if(p2d_state.p2d_region_sleeping) {
             SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            struct p2d_obb frustum = p2d_state.p2d_frustum;
-            struct p2d_obb_verts verts = p2d_obb_to_verts(frustum);
-            for(int i = 0; i < 4; i++) {
-                int i2 = (i + 1) % 4;
-                SDL_RenderLine(renderer, verts.verts[i].x, verts.verts[i].y, verts.verts[i2].x, verts.verts[i2].y);
-            }
+            SDL_FRect fr = {
+                .x = view.x,
+                .y = view.y,
+                .w = view.w,
+                .h = view.h,
+            };
+            SDL_RenderRect(renderer, &fr);
         }
 
         SDL_RenderPresent(renderer);
@@ -840,6 +842,7 @@ int main(int argc, char** argv) {
             printf("+---------------------+\n");
             printf("objects: %d\n", p2d_state.p2d_object_count);
             printf("sleeping: %d\n", p2d_state.p2d_sleeping_count);
+            printf("culled: %d\n", p2d_state.p2d_culled_count);
             printf("world nodes: %d\n", p2d_state.p2d_world_node_count);
             printf("contact checks: %d\n", p2d_state.p2d_contact_checks);
             printf("contacts found: %d\n", p2d_state.p2d_contacts_found);
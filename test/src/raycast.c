@@ -0,0 +1,394 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Checks raycasts against testing every body by brute force.
+
+    Scatters boxes and circles (static, awake and triggers, some on another layer) over a field
+    centered on the origin and fires rays from all over it, so plenty start and end at negative
+    coordinates, under two cell sizes. Every closest hit has to be the brute force answer to
+    within a hundredth of a pixel of every shape (so grazing a corner can go either way), and
+    p2d_raycast_all() has to report every body the ray crosses, nearest first. p2d_raycast_batch()
+    over the same rays has to agree with calling p2d_raycast() on each. Also fires rays from
+    negative coordinates at a body sitting just below zero, and at bodies the last solve of the
+    step pushed apart, out of the tiles they were in.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <p2d/p2d.h>
+
+#define GRID 30
+#define BODIES (GRID * GRID)
+#define SPACING 80.0f
+#define RAYS 3000
+#define RANGE 600.0f
+#define SLACK 0.01
+#define ROUNDING 1e-3
+
+static struct p2d_object objects[BODIES];
+static struct p2d_ray_query rays[RAYS];
+static struct p2d_raycast_hit hits[RAYS];
+static struct p2d_raycast_hit batch_hits[RAYS];
+
+static uint32_t seed = 12345u;
+
+static void quiet_log(int level, const char *fmt, ...) {
+    (void)level;
+    (void)fmt;
+}
+
+static float random_float(float lo, float hi) {
+    seed = seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(seed >> 8) / 16777216.0f;
+}
+
+/*
+    Distance along the ray to the body with its shape grown by pad (shrunk if negative), or -1
+    if it isn't hit or the ray starts inside
+*/
+static double ray_distance(const struct p2d_ray_query *ray, const struct p2d_object *o, double pad) {
+    double length = sqrt((double)ray->direction.x * ray->direction.x + (double)ray->direction.y * ray->direction.y);
+    double dx = ray->direction.x / length;
+    double dy = ray->direction.y / length;
+
+    if(o->type == P2D_OBJECT_CIRCLE) {
+        double mx = ray->origin.x - o->x;
+        double my = ray->origin.y - o->y;
+        double r = o->circle.radius + pad;
+        double b = mx * dx + my * dy;
+        double c = mx * mx + my * my - r * r;
+        double disc = b * b - c;
+        if(c <= 0.0 || b > 0.0 || disc < 0.0) {
+            return -1.0;
+        }
+        return -b - sqrt(disc);
+    }
+
+    double lo[2] = {o->x - pad, o->y - pad};
+    double hi[2] = {o->x + o->rectangle.width + pad, o->y + o->rectangle.height + pad};
+    double origin[2] = {ray->origin.x, ray->origin.y};
+    double direction[2] = {dx, dy};
+
+    double t_enter = -1e30;
+    double t_exit = 1e30;
+    for(int a = 0; a < 2; a++) {
+        if(fabs(direction[a]) < 1e-12) {
+            if(origin[a] < lo[a] || origin[a] > hi[a]) {
+                return -1.0;
+            }
+            continue;
+        }
+        double t0 = (lo[a] - origin[a]) / direction[a];
+        double t1 = (hi[a] - origin[a]) / direction[a];
+        if(t0 > t1) {
+            double swap = t0;
+            t0 = t1;
+            t1 = swap;
+        }
+        t_enter = t0 > t_enter ? t0 : t_enter;
+        t_exit = t1 < t_exit ? t1 : t_exit;
+    }
+    if(t_enter > t_exit || t_enter < 0.0) {
+        return -1.0;
+    }
+    return t_enter;
+}
+
+static bool ray_sees(const struct p2d_ray_query *ray, const struct p2d_object *o) {
+    return !o->is_trigger && (o->mask & ray->mask);
+}
+
+// nearest body the ray crosses with every shape grown by pad, -1 if none
+static int nearest_body(const struct p2d_ray_query *ray, double pad, double *distance) {
+    int best = -1;
+    *distance = ray->max_distance;
+    for(int i = 0; i < BODIES; i++) {
+        double t = ray_sees(ray, &objects[i]) ? ray_distance(ray, &objects[i], pad) : -1.0;
+        if(t >= 0.0 && t <= *distance) {
+            best = i;
+            *distance = t;
+        }
+    }
+    return best;
+}
+
+// the distance lies between meeting the body grown and shrunk by SLACK (shrunk it may be missed)
+static bool distance_matches(const struct p2d_ray_query *ray, const struct p2d_object *o, float distance) {
+    double outer = ray_distance(ray, o, SLACK);
+    double inner = ray_distance(ray, o, -SLACK);
+    return outer >= 0.0 && distance >= outer - ROUNDING && (inner < 0.0 || distance <= inner + ROUNDING);
+}
+
+// a hit is right if the hit body is where the ray meets it and nothing is clearly nearer
+static bool hit_matches(const struct p2d_ray_query *ray, bool found, const struct p2d_raycast_hit *hit) {
+    double nearest;
+    int clear = nearest_body(ray, -SLACK, &nearest);
+
+    if(!found) {
+        return clear < 0 || nearest > ray->max_distance - SLACK;
+    }
+
+    int i = (int)(hit->object - objects);
+    if(i < 0 || i >= BODIES || hit->handle != objects[i].handle || !ray_sees(ray, &objects[i])) {
+        return false;
+    }
+
+    return distance_matches(ray, &objects[i], hit->distance) && (clear < 0 || nearest >= hit->distance - ROUNDING);
+}
+
+struct all_hits {
+    const struct p2d_ray_query *ray;
+    float last;
+    int count;
+    bool ok;
+};
+
+static bool collect_hit(const struct p2d_raycast_hit *hit, void *user_data) {
+    struct all_hits *all = user_data;
+    int i = (int)(hit->object - objects);
+    if(i < 0 || i >= BODIES || !distance_matches(all->ray, &objects[i], hit->distance) || hit->distance < all->last) {
+        all->ok = false;
+    }
+    all->last = hit->distance;
+    all->count++;
+    return true;
+}
+
+// every body the ray clearly crosses is reported, nearest first
+static bool all_match(const struct p2d_ray_query *ray) {
+    struct all_hits all = {.ray = ray, .last = 0.0f, .count = 0, .ok = true};
+    p2d_raycast_all(ray->origin, ray->direction, ray->max_distance, ray->mask, collect_hit, &all);
+
+    int crossed = 0, touched = 0;
+    for(int i = 0; i < BODIES; i++) {
+        if(!ray_sees(ray, &objects[i])) {
+            continue;
+        }
+        double inner = ray_distance(ray, &objects[i], -SLACK);
+        double outer = ray_distance(ray, &objects[i], SLACK);
+        crossed += inner >= 0.0 && inner < ray->max_distance - SLACK;
+        touched += outer >= 0.0 && outer <= ray->max_distance + SLACK;
+    }
+    return all.ok && all.count >= crossed && all.count <= touched;
+}
+
+static void build_field(void) {
+    for(int i = 0; i < BODIES; i++) {
+        struct p2d_object *o = &objects[i];
+        float x = ((float)(i % GRID) - GRID / 2) * SPACING + random_float(-20.0f, 20.0f);
+        float y = ((float)(i / GRID) - GRID / 2) * SPACING + random_float(-20.0f, 20.0f);
+
+        *o = (struct p2d_object){
+            .type = (i % 3) ? P2D_OBJECT_RECTANGLE : P2D_OBJECT_CIRCLE,
+            .is_static = (i % 4) != 0, .is_trigger = (i % 11) == 0,
+            .x = x, .y = y,
+            .density = 1, .static_friction = 1, .dynamic_friction = .7f,
+            .mask = (i % 5) == 0 ? 0x0002 : 0xFFFF
+        };
+        if(o->type == P2D_OBJECT_RECTANGLE) {
+            o->rectangle.width = random_float(8.0f, 40.0f);
+            o->rectangle.height = random_float(8.0f, 40.0f);
+        }
+        else {
+            o->circle.radius = random_float(4.0f, 20.0f);
+        }
+        if(o->is_trigger) {
+            o->is_static = true;
+        }
+        p2d_create_object(o);
+    }
+}
+
+static bool starts_inside(vec2_t origin) {
+    for(int i = 0; i < BODIES; i++) {
+        const struct p2d_object *o = &objects[i];
+        bool inside = o->type == P2D_OBJECT_CIRCLE
+            ? hypot(origin.x - o->x, origin.y - o->y) <= o->circle.radius + SLACK
+            : origin.x >= o->x - SLACK && origin.x <= o->x + o->rectangle.width + SLACK &&
+              origin.y >= o->y - SLACK && origin.y <= o->y + o->rectangle.height + SLACK;
+        if(inside) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void build_rays(void) {
+    float half = GRID / 2 * SPACING;
+    for(int r = 0; r < RAYS; r++) {
+        vec2_t origin;
+        do {
+            origin = (vec2_t){{random_float(-half - 100.0f, half + 100.0f), random_float(-half - 100.0f, half + 100.0f)}};
+        } while(starts_inside(origin));
+
+        float angle = random_float(0.0f, 6.2831853f);
+        rays[r] = (struct p2d_ray_query){
+            .origin = origin,
+            .direction = {{cosf(angle) * 3.0f, sinf(angle) * 3.0f}},
+            .max_distance = RANGE,
+            .mask = (r % 4) == 0 ? 0x0001 : 0xFFFF
+        };
+    }
+}
+
+// the batch kernels work the slabs out in another order, so allow for rounding (and exact ties)
+static bool batch_matches(const struct p2d_raycast_hit *single, const struct p2d_raycast_hit *batch) {
+    if(single->handle < 0 || batch->handle < 0) {
+        return single->handle == batch->handle && batch->object == NULL;
+    }
+
+    bool close = fabsf(single->distance - batch->distance) < ROUNDING &&
+                 fabsf(single->point.x - batch->point.x) < ROUNDING && fabsf(single->point.y - batch->point.y) < ROUNDING;
+    bool same = single->handle == batch->handle && single->object == batch->object &&
+                fabsf(single->normal.x - batch->normal.x) < ROUNDING && fabsf(single->normal.y - batch->normal.y) < ROUNDING;
+    return close && (same || single->distance == batch->distance);
+}
+
+// every ray against brute force, then the batch against the single rays, counts the hits into found
+static bool check_rays(const char *name, int *found) {
+    bool ok = true;
+    *found = 0;
+    for(int r = 0; r < RAYS && ok; r++) {
+        const struct p2d_ray_query *ray = &rays[r];
+        bool hit = p2d_raycast(ray->origin, ray->direction, ray->max_distance, ray->mask, &hits[r]);
+        *found += hit;
+        if(!hit) {
+            // left alone on a miss, the batch marks it
+            hits[r] = (struct p2d_raycast_hit){.handle = -1};
+        }
+
+        if(!hit_matches(ray, hit, &hits[r])) {
+            printf("%s: ray %d from (%f, %f) %s\n", name, r, ray->origin.x, ray->origin.y,
+                hit ? "hit the wrong body" : "missed");
+            ok = false;
+        }
+        else if(r % 10 == 0 && !all_match(ray)) {
+            printf("%s: ray %d from (%f, %f) didn't report every body it crosses\n", name, r, ray->origin.x, ray->origin.y);
+            ok = false;
+        }
+    }
+
+    int batch_found = p2d_raycast_batch(rays, RAYS, batch_hits);
+    for(int r = 0; r < RAYS && ok; r++) {
+        if(!batch_matches(&hits[r], &batch_hits[r])) {
+            printf("%s: ray %d from (%f, %f) hit handle %d at %f in the batch, %d at %f alone\n", name, r,
+                rays[r].origin.x, rays[r].origin.y, batch_hits[r].handle, batch_hits[r].distance, hits[r].handle, hits[r].distance);
+            ok = false;
+        }
+    }
+    if(ok && batch_found != *found) {
+        printf("%s: the batch hit %d rays, alone %d\n", name, batch_found, *found);
+        ok = false;
+    }
+    return ok;
+}
+
+static bool check_field(int cell_size) {
+    p2d_init(cell_size, NULL, NULL, quiet_log);
+    p2d_state.p2d_gravity = (vec2_t){{0, 0}};
+
+    seed = 12345u;
+    build_field();
+    build_rays();
+    p2d_step(1.0f / 60.0f);
+
+    char name[32];
+    snprintf(name, sizeof(name), "cell size %d", cell_size);
+    int found;
+    bool ok = check_rays(name, &found);
+
+    printf("cell size %3d  %d of %d rays hit\n", cell_size, found, RAYS);
+
+    p2d_shutdown();
+    return ok;
+}
+
+/*
+    Pairs of awake bodies dropped into each other all over the field, with a single substep, so
+    the step's only solve pushes them apart after they were put in the grid, often across a tile
+    border
+*/
+static bool check_pushed(void) {
+    p2d_init(64, NULL, NULL, quiet_log);
+    p2d_state.p2d_gravity = (vec2_t){{0, 0}};
+    p2d_state.p2d_substeps = 1;
+
+    seed = 777u;
+    for(int i = 0; i < BODIES; i += 2) {
+        float center_x = random_float(-1150.0f, 1150.0f);
+        float center_y = random_float(-1150.0f, 1150.0f);
+        float angle = random_float(0.0f, 6.2831853f);
+        float apart = random_float(6.0f, 14.0f);
+
+        for(int k = 0; k < 2; k++) {
+            struct p2d_object *o = &objects[i + k];
+            float side = k ? 0.5f : -0.5f;
+            *o = (struct p2d_object){
+                .type = P2D_OBJECT_CIRCLE,
+                .x = center_x + cosf(angle) * apart * side, .y = center_y + sinf(angle) * apart * side,
+                .circle = {.radius = random_float(8.0f, 16.0f)},
+                .density = 1, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+            };
+            p2d_create_object(o);
+        }
+    }
+    build_rays();
+
+    float before = objects[0].x;
+    p2d_step(1.0f / 60.0f);
+
+    int found;
+    bool ok = check_rays("pushed apart", &found);
+    if(objects[0].x == before) {
+        printf("the pairs were never pushed apart\n");
+        ok = false;
+    }
+
+    printf("pushed apart   %d of %d rays hit\n", found, RAYS);
+
+    p2d_shutdown();
+    return ok;
+}
+
+// a body entirely below zero, in the tiles just before it
+static bool check_below_zero(void) {
+    p2d_init(64, NULL, NULL, quiet_log);
+
+    static struct p2d_object target;
+    target = (struct p2d_object){
+        .type = P2D_OBJECT_RECTANGLE, .is_static = true, .x = -40, .y = -40,
+        .rectangle = {.width = 20, .height = 20}, .density = 1, .mask = 0xFFFF
+    };
+    p2d_create_object(&target);
+    p2d_step(1.0f / 60.0f);
+
+    struct p2d_raycast_hit across, down;
+    bool ok = p2d_raycast((vec2_t){{-100, -30}}, (vec2_t){{1, 0}}, 200, 0xFFFF, &across) &&
+              p2d_raycast((vec2_t){{-30, -100}}, (vec2_t){{0, 1}}, 200, 0xFFFF, &down) &&
+              across.object == &target && fabsf(across.distance - 60.0f) < 1e-3f && across.normal.x == -1.0f &&
+              down.object == &target && fabsf(down.distance - 60.0f) < 1e-3f && down.normal.y == -1.0f;
+    if(!ok) {
+        printf("rays from negative coordinates missed a body below zero\n");
+    }
+
+    p2d_shutdown();
+    return ok;
+}
+
+int main(void) {
+    bool ok = check_below_zero();
+    ok = check_field(64) && ok;
+    ok = check_field(37) && ok;
+    ok = check_pushed() && ok;
+
+    printf(ok ? "raycast ok\n" : "raycast FAILED\n");
+    return ok ? 0 : 1;
+}
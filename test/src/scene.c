@@ -0,0 +1,183 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Round trip check and benchmark for binary scenes.
+
+    Writes a level with 20000 static bodies (baked for one cell size), a pile of dynamic ones and
+    a few joints, then steps it once built object by object and once loaded from the mapped file,
+    which have to come out bit for bit the same. Also loads it with another cell size, where the
+    baked tiles can't be used.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <p2d/p2d.h>
+
+#define STATICS 20000
+#define DYNAMICS 500
+#define BODIES (STATICS + DYNAMICS)
+#define JOINTS 10
+#define STEPS 120
+#define PATH "p2d-scene-test.p2ds"
+
+static struct p2d_object level[BODIES];
+static struct p2d_joint level_joints[JOINTS];
+
+static struct p2d_object objects[BODIES];
+static struct p2d_joint joints[JOINTS];
+
+static void quiet_log(int level, const char *fmt, ...) {
+    (void)level;
+    (void)fmt;
+}
+
+static uint64_t hash_objects(void) {
+    uint64_t hash = 14695981039346656037ull;
+    for(int i = 0; i < BODIES; i++) {
+        const struct p2d_object *o = &objects[i];
+        float state[6] = {o->x, o->y, o->rotation, o->vx, o->vy, o->vr};
+        const unsigned char *bytes = (const unsigned char *)state;
+        for(size_t b = 0; b < sizeof(state); b++) {
+            hash ^= bytes[b];
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+static void build_level(void) {
+    // a rough floor of boxes and circles, rotated a bit
+    for(int i = 0; i < STATICS; i++) {
+        struct p2d_object *o = &level[i];
+        *o = (struct p2d_object){
+            .type = (i % 3) ? P2D_OBJECT_RECTANGLE : P2D_OBJECT_CIRCLE, .is_static = true,
+            .x = (float)(i % 200) * 40.0f - 2000.0f, .y = 1500.0f + (float)(i / 200) * 40.0f, .rotation = (float)(i % 7) * 5.0f,
+            .density = 1, .restitution = .3f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+        };
+        if(o->type == P2D_OBJECT_RECTANGLE) {
+            o->rectangle.width = 38;
+            o->rectangle.height = 30;
+        }
+        else {
+            o->circle.radius = 17;
+        }
+    }
+
+    for(int i = 0; i < DYNAMICS; i++) {
+        struct p2d_object *o = &level[STATICS + i];
+        *o = (struct p2d_object){
+            .type = (i % 4) ? P2D_OBJECT_RECTANGLE : P2D_OBJECT_CIRCLE,
+            .x = (float)(i % 50) * 45.0f - 1100.0f, .y = 1400.0f - (float)(i / 50) * 45.0f,
+            .density = 2, .restitution = .1f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+        };
+        if(o->type == P2D_OBJECT_RECTANGLE) {
+            o->rectangle.width = 36;
+            o->rectangle.height = 36;
+        }
+        else {
+            o->circle.radius = 18;
+        }
+    }
+
+    for(int j = 0; j < JOINTS; j++) {
+        level_joints[j] = (struct p2d_joint){
+            .type = P2D_JOINT_SPRING, .a = &level[STATICS + j * 3], .b = &level[STATICS + j * 3 + 50], .bias_factor = 0.2f,
+            .spring_joint = {.rest_length = 45, .spring_constant = 0.5f}
+        };
+    }
+    level_joints[JOINTS - 1].anchored_to_world = true;
+    level_joints[JOINTS - 1].world_anchor_b = (vec2_t){{-1000.0f, 1000.0f}};
+}
+
+static double seconds_since(clock_t start) {
+    return (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+}
+
+// steps the level built one of two ways, returns false if it couldn't be loaded
+static bool run(int cell_size, bool from_scene, uint64_t *hash) {
+    p2d_init(cell_size, NULL, NULL, quiet_log);
+    p2d_state.p2d_gravity = (vec2_t){{0, 60.0f}};
+
+    clock_t start = clock();
+    if(from_scene) {
+        struct p2d_scene scene;
+        if(!p2d_scene_open(PATH, &scene)) {
+            p2d_shutdown();
+            return false;
+        }
+        bool loaded = scene.body_count == BODIES && scene.joint_count == JOINTS && p2d_scene_load(&scene, objects, joints);
+        p2d_scene_close(&scene);
+        if(!loaded) {
+            p2d_shutdown();
+            return false;
+        }
+    }
+    else {
+        memcpy(objects, level, sizeof(objects));
+        for(int i = 0; i < BODIES; i++) {
+            p2d_create_object(&objects[i]);
+        }
+        for(int j = 0; j < JOINTS; j++) {
+            joints[j] = level_joints[j];
+            joints[j].a = &objects[level_joints[j].a - level];
+            if(!joints[j].anchored_to_world) {
+                joints[j].b = &objects[level_joints[j].b - level];
+            }
+            p2d_add_joint(&joints[j]);
+        }
+    }
+    p2d_step(1.0f / 60.0f);
+    double startup = seconds_since(start);
+
+    for(int i = 1; i < STEPS; i++) {
+        p2d_step(1.0f / 60.0f);
+    }
+    *hash = hash_objects();
+
+    printf("cell size %3d  %-16s %8.2f ms to the end of the first step  hash %016llx\n",
+        cell_size, from_scene ? "scene" : "object by object", startup * 1e3, (unsigned long long)*hash);
+
+    p2d_shutdown();
+    return true;
+}
+
+int main(void) {
+    build_level();
+
+    // baked for 64
+    p2d_init(64, NULL, NULL, quiet_log);
+    bool ok = p2d_scene_write(PATH, level, BODIES, level_joints, JOINTS, true);
+    p2d_shutdown();
+    if(!ok) {
+        printf("failed to write %s\n", PATH);
+        return 1;
+    }
+
+    int cell_sizes[] = {64, 48};
+    for(int c = 0; c < 2; c++) {
+        uint64_t built, loaded;
+        if(!run(cell_sizes[c], false, &built) || !run(cell_sizes[c], true, &loaded)) {
+            printf("failed to load %s\n", PATH);
+            ok = false;
+            break;
+        }
+        if(built != loaded) {
+            printf("cell size %d: the loaded scene came out differently\n", cell_sizes[c]);
+            ok = false;
+        }
+    }
+
+    remove(PATH);
+
+    printf(ok ? "scene ok\n" : "scene FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+/*
+    This file is a part of yoyoengine. (https://github.com/yoyoengine)
+    Copyright (C) 2023-2025  Ryan Zmuda
+
+    Licensed under the MIT license. See LICENSE file in the project root for details.
+*/
+
+/*
+    Rollback check and benchmark for world snapshots.
+
+    Steps a 2000 body scene (with sleeping, culled and level of detail bodies), saves it, runs a
+    few frames that create and remove objects and joints, rolls back and runs the same frames
+    again, which have to come out bit for bit the same. Then times save + restore.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <p2d/p2d.h>
+
+#define BODIES 2000
+#define COLUMNS 100
+#define SHELVED 40
+#define SPARES 16
+#define JOINTS 20
+#define WARMUP 90
+#define FRAMES 8
+#define ROUNDS 1000
+
+static struct p2d_object ground;
+static struct p2d_object shelf;
+static struct p2d_object objects[BODIES];
+static struct p2d_object spares[SPARES];
+static struct p2d_joint joints[JOINTS + 1];
+
+static void quiet_log(int level, const char *fmt, ...) {
+    (void)level;
+    (void)fmt;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hash_object(uint64_t hash, const struct p2d_object *o) {
+    float state[7] = {o->x, o->y, o->rotation, o->vx, o->vy, o->vr, o->sleep_time};
+    unsigned char flags[4] = {o->handle >= 0, o->sleeping, o->culled, o->parked};
+    hash = hash_bytes(hash, state, sizeof(state));
+    return hash_bytes(hash, flags, sizeof(flags));
+}
+
+static uint64_t hash_world(void) {
+    uint64_t hash = 14695981039346656037ull;
+    for(int i = 0; i < BODIES; i++) {
+        hash = hash_object(hash, &objects[i]);
+    }
+    // spares dropped by a rollback keep whatever they last had, that's fine
+    for(int i = 0; i < SPARES; i++) {
+        if(spares[i].handle >= 0) {
+            hash = hash_object(hash, &spares[i]);
+        }
+    }
+    int joint_count = p2d_state.p2d_joint_count;
+    return hash_bytes(hash, &joint_count, sizeof(joint_count));
+}
+
+static void build_scene(void) {
+    for(int i = 0; i < SPARES; i++) {
+        spares[i].handle = -1;
+    }
+
+    ground = (struct p2d_object){
+        .type = P2D_OBJECT_RECTANGLE, .is_static = true, .x = -100, .y = 1400,
+        .rectangle = {.width = 6000, .height = 40},
+        .density = 1, .restitution = .3f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+    };
+    p2d_create_object(&ground);
+
+    // a few bodies sit apart from the pile, so they fall asleep
+    shelf = (struct p2d_object){
+        .type = P2D_OBJECT_RECTANGLE, .is_static = true, .x = 0, .y = 300,
+        .rectangle = {.width = 1600, .height = 20},
+        .density = 1, .restitution = .3f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+    };
+    p2d_create_object(&shelf);
+
+    for(int i = 0; i < BODIES; i++) {
+        struct p2d_object *o = &objects[i];
+        bool box = (i % 4) != 0;
+
+        *o = (struct p2d_object){
+            .type = box ? P2D_OBJECT_RECTANGLE : P2D_OBJECT_CIRCLE,
+            .x = (float)(i % COLUMNS) * 50.0f,
+            .y = 1360.0f - (float)(i / COLUMNS) * 42.0f,
+            .density = 2, .restitution = .1f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+        };
+        if(box) {
+            o->rectangle.width = 36;
+            o->rectangle.height = 36;
+        }
+        else {
+            o->circle.radius = 18;
+        }
+
+        if(i >= BODIES - SHELVED) {
+            o->type = P2D_OBJECT_RECTANGLE;
+            o->rectangle.width = o->rectangle.height = 36;
+            o->x = (float)(i - (BODIES - SHELVED)) * 39.0f;
+            o->y = 300.0f - 36.0f;
+        }
+        p2d_create_object(o);
+    }
+
+    for(int j = 0; j < JOINTS; j++) {
+        int a = j * 37 % (BODIES - COLUMNS);
+        joints[j] = (struct p2d_joint){
+            .type = P2D_JOINT_SPRING, .a = &objects[a], .b = &objects[a + COLUMNS], .bias_factor = 0.2f,
+            .spring_joint = {.rest_length = 42, .spring_constant = 0.5f}
+        };
+        p2d_add_joint(&joints[j]);
+    }
+
+    // the right part of the pile is culled, the middle runs at a lower level of detail
+    p2d_state.p2d_region_sleeping = true;
+    p2d_state.p2d_lod_tiers = 2;
+    p2d_state.p2d_lod_distance = 600;
+    p2d_add_region((struct p2d_aabb){.x = -200, .y = 0, .w = 2000, .h = 1600});
+}
+
+// the inputs of one frame: throw things in, take things out, wake things up, rewire a joint
+static void play_frame(int frame) {
+    struct p2d_object *spare = &spares[frame * 2 % SPARES];
+    *spare = (struct p2d_object){
+        .type = P2D_OBJECT_CIRCLE, .x = 200.0f + (float)frame * 90.0f, .y = 150, .vx = 300, .vy = 400,
+        .circle = {.radius = 10}, .density = 8, .restitution = .5f, .static_friction = 1, .dynamic_friction = .7f, .mask = 0xFFFF
+    };
+    p2d_create_object(spare);
+
+    p2d_remove_object(&objects[BODIES - COLUMNS + frame * 3]);
+
+    if(frame == 1) {
+        p2d_wake_object(&objects[BODIES - SHELVED / 2]);
+    }
+    if(frame == 2) {
+        p2d_remove_joint(&joints[5]);
+    }
+    if(frame == 4) {
+        joints[JOINTS] = (struct p2d_joint){
+            .type = P2D_JOINT_SPRING, .a = &objects[150], .b = spare, .bias_factor = 0.2f,
+            .spring_joint = {.rest_length = 100, .spring_constant = 0.8f}
+        };
+        p2d_add_joint(&joints[JOINTS]);
+    }
+
+    p2d_step(1.0f / 60.0f);
+}
+
+static double seconds_since(clock_t start) {
+    return (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+}
+
+int main(void) {
+    if(!p2d_init(64, NULL, NULL, quiet_log)) {
+        printf("failed to init\n");
+        return 1;
+    }
+    p2d_state.p2d_gravity = (vec2_t){{0, 60.0f}};
+
+    build_scene();
+    for(int i = 0; i < WARMUP; i++) {
+        p2d_step(1.0f / 60.0f);
+    }
+
+    size_t size = p2d_snapshot_size();
+    void *snapshot = malloc(size);
+    if(!snapshot || p2d_snapshot_save(snapshot, size) != size) {
+        printf("failed to save\n");
+        return 1;
+    }
+    uint64_t saved = hash_world();
+
+    printf("%d bodies (%d asleep, %d culled, %d parked), snapshot is %zu bytes\n",
+        p2d_state.p2d_object_count, p2d_state.p2d_sleeping_count, p2d_state.p2d_culled_count, p2d_state.p2d_parked_count, size);
+
+    uint64_t played[FRAMES];
+    for(int frame = 0; frame < FRAMES; frame++) {
+        play_frame(frame);
+        played[frame] = hash_world();
+    }
+
+    /*
+        Roll back and play the same frames again
+    */
+    bool ok = p2d_snapshot_restore(snapshot, size);
+    if(!ok || hash_world() != saved) {
+        printf("restore did not bring back the saved state\n");
+        ok = false;
+    }
+
+    for(int frame = 0; frame < FRAMES; frame++) {
+        play_frame(frame);
+        if(hash_world() != played[frame]) {
+            printf("frame %d came out differently after the rollback\n", frame);
+            ok = false;
+            break;
+        }
+    }
+
+    /*
+        Benchmark
+    */
+    void *scratch = malloc(size);
+    size_t scratch_size = p2d_snapshot_size();
+    if(scratch_size > size) {
+        free(scratch);
+        scratch = malloc(scratch_size);
+    }
+
+    clock_t start = clock();
+    for(int i = 0; i < ROUNDS; i++) {
+        p2d_snapshot_save(scratch, scratch_size);
+    }
+    double save_time = seconds_since(start);
+
+    start = clock();
+    for(int i = 0; i < ROUNDS; i++) {
+        p2d_snapshot_restore(snapshot, size);
+    }
+    double restore_time = seconds_since(start);
+
+    printf("save    %8.2f us\n", save_time * 1e6 / ROUNDS);
+    printf("restore %8.2f us\n", restore_time * 1e6 / ROUNDS);
+
+    free(scratch);
+    free(snapshot);
+    p2d_shutdown();
+
+    printf(ok ? "rollback ok\n" : "rollback FAILED\n");
+    return ok ? 0 : 1;
+}